@@ -9,14 +9,16 @@
 
 #include <vector>
 
+#include "base/stats.h"
+
 namespace base {
 BitString& BitString::operator=(const BitString& rhs) {
   size_ = rhs.size_;
-  memcpy(bytes_.data(), rhs.bytes_.data(), bytes_.size());
+  bytes_ = rhs.bytes_;
   return *this;
 }
 
-bool BitString::Set(uint32_t index, bool value) {
+bool BitString::Set(uint64_t index, bool value) {
   assert(index < size_);
 
   if (value) {  // Bitmask to set the appropriate bit
@@ -28,7 +30,7 @@ bool BitString::Set(uint32_t index, bool value) {
   return value;  // Return the input value to allow chaining
 }
 
-bool BitString::Get(uint32_t index) const {
+bool BitString::Get(uint64_t index) const {
   assert(index < size_);
 
   uint8_t byte = bytes_.at(index / kByteBits);
@@ -58,7 +60,7 @@ void BitString::Append(bool value) {
 
 // TODO(hxtk): optimize edge case where memory copy is possible
 void BitString::Append(const BitString& bits) {
-  for (int i = 0; i < bits.size(); ++i) {
+  for (uint64_t i = 0; i < bits.size(); ++i) {
     this->Append(bits.Get(i));
   }
 }
@@ -74,39 +76,46 @@ void BitString::PopBack() {
   --size_;
 }
 
-void BitString::Serialize(void** buffer, int* size) const {
-  *size = sizeof(size_) + bytes_.size();
-  *buffer = new uint8_t[*size];
-
-  uint32_t* int_ptr = reinterpret_cast<uint32_t*>(*buffer);
-  *int_ptr = size_;
+void BitString::Serialize(void** buffer, int64_t* size) const {
+  STATS_TIMER(kSerializeStage);
+  *size = static_cast<int64_t>(sizeof(size_) + bytes_.size());
+  uint8_t* working_buf = new uint8_t[*size];
+  *buffer = working_buf;
 
-  memcpy(*buffer + sizeof(size_), bytes_.data(), bytes_.size());
+  memcpy(working_buf, &size_, sizeof(size_));
+  memcpy(working_buf + sizeof(size_), bytes_.data(), bytes_.size());
 }
 
-bool BitString::Unserialize(const void* input, int size) {
+bool BitString::Unserialize(const void* input, int64_t size) {
   this->clear();
 
   // There must be at least enough space for the size header
-  if (size < sizeof(size_))
+  if (size < static_cast<int64_t>(sizeof(size_)))
     return false;
   
-  size_ = *(reinterpret_cast<const uint32_t*>(input));
+  memcpy(&size_, input, sizeof(size_));
 
   // Since we cannot allocate fractions of bytes, a trailing partially-filled
   // byte must be considered full. As such we use a least-integer function
   // which is less trivial than the greatest-integer function without the use
   // of math libraries.
-  uint32_t container_size = (size_ % 8 == 0) ? (size_ / 8) : ((size_ / 8) + 1);
+  uint64_t container_size = (size_ % 8 == 0) ? (size_ / 8) : ((size_ / 8) + 1);
 
-  // Now the size is well-defined, we can make the final size test.
-  if (size < container_size)
+  // Now the size is well-defined, we can make the final size test. The
+  // bytes follow the size header, so they are compared with what remains.
+  if (static_cast<uint64_t>(size) - sizeof(size_) < container_size) {
+    size_ = 0;
     return false;
+  }
 
   // Now that the container has the proper size
   // copy the data segment of the buffer into it
   bytes_.resize(container_size);
-  memcpy(bytes_.data(), input + sizeof(size_), bytes_.size());
+  if (container_size > 0) {
+    memcpy(bytes_.data(),
+           reinterpret_cast<const uint8_t*>(input) + sizeof(size_),
+           bytes_.size());
+  }
 
   return true;
 }
@@ -38,12 +38,12 @@ class BitString {
   // Here, the bit within the byte is selected such that the bits could
   // be read contiguously left-to-right.
   // Bounds checking is performed. New elements can NOT be added this way.
-  bool Set(uint32_t index, bool value);
+  bool Set(uint64_t index, bool value);
 
   // This function retreives the value at the given index by fetching the
   // |index % 8|th bit from the left of the |index / 8|th byte.
   // Bounds checking is performed.
-  bool Get(uint32_t index) const;
+  bool Get(uint64_t index) const;
 
   // Pack a new value onto the back of the array, incrementing the size.
   // Placement conventions are the same as those described in `Set()`
@@ -57,22 +57,38 @@ class BitString {
   // Removes the back item and reduces the size of the bitstring by one
   void PopBack();
 
-  // Returns a byte array which contains a four byte header representing the
+  // Returns a byte array which contains an eight byte header representing the
   // number of bits in the bitstring followed by |size_ / 8| bytes containing
   // the stored bits. The size header is necessary because the last byte may
   // contain between one (1) and eight (8) well-defined bits.
   // NOTE: the calling context is responsible for deleting this pointer
-  void Serialize(void** buffer, int* size) const;
+  void Serialize(void** buffer, int64_t* size) const;
 
   // Given a string of the format described above, decode it to a bitstring.
-  bool Unserialize(const void* input, int size);
+  bool Unserialize(const void* input, int64_t size);
 
   // Returns the number of bools packed in the container.
-  uint32_t size() const {
+  uint64_t size() const {
     return size_;
   }
+
+  // Changes the number of bools packed in the container to |size|.
+  // Any bits which are added are not well-defined until they are |Set|.
+  void resize(uint64_t size) {
+    size_ = size;
+    bytes_.resize((size + kByteBits - 1) / kByteBits);
+  }
+
+  // Direct access to the packed bytes, for code which reads or writes
+  // many bits at a time. Bits are ordered as described in |Set|.
+  uint8_t* data() {
+    return bytes_.data();
+  }
+  const uint8_t* data() const {
+    return bytes_.data();
+  }
   void clear() {
-    bytes_.resize(1);
+    bytes_.clear();
     size_ = 0;
   }
   bool empty() {
@@ -80,7 +96,7 @@ class BitString {
   }
 
   friend std::ostream& operator<<(std::ostream& lhs, const BitString& rhs) {
-    for (int i = 0; i < rhs.size(); ++i) {
+    for (uint64_t i = 0; i < rhs.size(); ++i) {
       lhs << rhs.Get(i);
       if (i % 4 == 3)
         lhs << " ";
@@ -90,7 +106,7 @@ class BitString {
   }
  private:  
   std::vector<uint8_t> bytes_ = {};
-  uint32_t size_ = 0;
+  uint64_t size_ = 0;
 
 };  // class bitstring
 }  // namespace hxtk
@@ -55,7 +55,7 @@ int main(int argc, char** argv) {
   
   cout << "Serialize third string" << endl;
   void* buffer = nullptr;
-  int size = -1;
+  int64_t size = -1;
   bs3.Serialize(&buffer, &size);
 
   cout << "Serialized.\nSize: " << size << " bytes. Unserializing." << endl;
@@ -0,0 +1,116 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+
+#include "base/crc32c.h"
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __x86_64__
+#include <nmmintrin.h>
+#endif
+
+namespace base {
+namespace {
+// The Castagnoli polynomial, bit-reversed.
+static constexpr uint32_t kPolynomial = 0x82F63B78;
+
+static constexpr int kSlices = 8;
+
+// |table[0]| advances the checksum by one byte. |table[k]| advances it by
+// one byte followed by |k| zero bytes, so that eight bytes can be folded in
+// with eight independent lookups.
+struct Tables {
+  Tables() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ (kPolynomial & (0 - (crc & 1)));
+      }
+      table[0][i] = crc;
+    }
+    for (int k = 1; k < kSlices; ++k) {
+      for (int i = 0; i < 256; ++i) {
+        uint32_t previous = table[k - 1][i];
+        table[k][i] = (previous >> 8) ^ table[0][previous & 0xFF];
+      }
+    }
+  }
+
+  uint32_t table[kSlices][256];
+};
+
+const Tables& GetTables() {
+  static const Tables tables;
+  return tables;
+}
+
+inline uint32_t LoadLittleEndian(const uint8_t* bytes) {
+  return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) |
+      (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+uint32_t Portable(const uint8_t* data, int64_t size, uint32_t crc) {
+  const uint32_t (*table)[256] = GetTables().table;
+
+  for (; size >= kSlices; size -= kSlices, data += kSlices) {
+    uint32_t low = LoadLittleEndian(data) ^ crc;
+    uint32_t high = LoadLittleEndian(data + 4);
+    crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^
+        table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+        table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^
+        table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+  }
+  for (; size > 0; --size) {
+    crc = (crc >> 8) ^ table[0][(crc ^ *data++) & 0xFF];
+  }
+  return crc;
+}
+
+#ifdef __x86_64__
+__attribute__((target("sse4.2")))
+uint32_t Hardware(const uint8_t* data, int64_t size, uint32_t crc) {
+  uint64_t crc64 = crc;
+  for (; size >= 8; size -= 8, data += 8) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  crc = static_cast<uint32_t>(crc64);
+  for (; size > 0; --size) {
+    crc = _mm_crc32_u8(crc, *data++);
+  }
+  return crc;
+}
+
+bool HasHardware() {
+  static const bool has_hardware = __builtin_cpu_supports("sse4.2");
+  return has_hardware;
+}
+#else
+uint32_t Hardware(const uint8_t* data, int64_t size, uint32_t crc) {
+  return Portable(data, size, crc);
+}
+
+bool HasHardware() {
+  return false;
+}
+#endif  // __x86_64__
+}  // namespace
+
+uint32_t Crc32c(const void* data, int64_t size, uint32_t crc) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+  if (HasHardware()) {
+    return ~Hardware(bytes, size, ~crc);
+  }
+  return ~Portable(bytes, size, ~crc);
+}
+
+uint32_t Crc32cPortable(const void* data, int64_t size, uint32_t crc) {
+  return ~Portable(reinterpret_cast<const uint8_t*>(data), size, ~crc);
+}
+
+bool Crc32cIsAccelerated() {
+  return HasHardware();
+}
+}  // namespace base
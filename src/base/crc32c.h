@@ -0,0 +1,27 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// These functions compute the CRC-32C (Castagnoli) checksum, as used by
+// iSCSI, ext4 and many storage formats. On x86-64 processors with SSE4.2
+// the dedicated instruction is used; elsewhere a table-driven
+// implementation processes eight bytes per step ("slicing-by-8").
+
+#ifndef HUFFMAN_BASE_CRC32C_H_
+#define HUFFMAN_BASE_CRC32C_H_
+
+#include <cstdint>
+
+namespace base {
+// Returns the checksum of the |size| bytes at |data|. To checksum data in
+// pieces, pass the checksum of everything before this piece as |crc|.
+uint32_t Crc32c(const void* data, int64_t size, uint32_t crc = 0);
+
+// As above, but never uses the hardware instruction. This is exposed so
+// that the two can be compared.
+uint32_t Crc32cPortable(const void* data, int64_t size, uint32_t crc = 0);
+
+// Returns true if |Crc32c| uses the hardware instruction.
+bool Crc32cIsAccelerated();
+}  // namespace base
+
+#endif  // HUFFMAN_BASE_CRC32C_H_
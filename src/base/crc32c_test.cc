@@ -0,0 +1,92 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// Unit test for CRC-32C
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "base/crc32c.h"
+
+using std::cout;
+using std::endl;
+using std::hex;
+using std::dec;
+using std::string;
+using std::vector;
+
+namespace {
+// Checks both implementations against a published check value.
+bool TestKnown(const string& name, const vector<uint8_t>& data,
+               uint32_t expected) {
+  int64_t size = static_cast<int64_t>(data.size());
+  uint32_t crc = base::Crc32c(data.data(), size);
+  uint32_t portable = base::Crc32cPortable(data.data(), size);
+  bool sane = (crc == expected && portable == expected);
+  cout << name << ": " << hex << crc << dec << " " << sane << endl;
+  return sane;
+}
+}  // namespace
+
+int main() {
+  bool all_passed = true;
+
+  // Check values from RFC 3720, section B.4.
+  string digits = "123456789";
+  all_passed &= TestKnown("Digits", vector<uint8_t>(digits.begin(),
+                                                    digits.end()),
+                          0xE3069283);
+  all_passed &= TestKnown("Zeros", vector<uint8_t>(32, 0), 0x8A9136AA);
+  all_passed &= TestKnown("Ones", vector<uint8_t>(32, 0xFF), 0x62A8AB43);
+  vector<uint8_t> ascending(32);
+  for (size_t i = 0; i < ascending.size(); ++i) {
+    ascending[i] = static_cast<uint8_t>(i);
+  }
+  all_passed &= TestKnown("Ascending", ascending, 0x46DD794E);
+  all_passed &= TestKnown("Empty", vector<uint8_t>(), 0);
+
+  // Every length and alignment must agree between the two implementations,
+  // and checksumming in pieces must match checksumming all at once.
+  vector<uint8_t> data(4096 + 64);
+  srand(1);
+  for (auto it = data.begin(); it != data.end(); ++it) {
+    *it = rand();
+  }
+  bool agree = true;
+  for (int offset = 0; offset < 8; ++offset) {
+    for (int size = 0; size < 200; ++size) {
+      const uint8_t* piece = data.data() + offset;
+      uint32_t whole = base::Crc32c(piece, size);
+      agree &= (whole == base::Crc32cPortable(piece, size));
+      uint32_t split = base::Crc32c(piece, size / 3);
+      split = base::Crc32c(piece + size / 3, size - size / 3, split);
+      agree &= (whole == split);
+    }
+  }
+  cout << "Accelerated: " << base::Crc32cIsAccelerated() << endl;
+  cout << "Implementations agree: " << agree << endl;
+  all_passed &= agree;
+
+  // Throughput, for reference.
+  vector<uint8_t> large(64 << 20, 0x5A);
+  auto start = std::chrono::steady_clock::now();
+  base::Crc32c(large.data(), static_cast<int64_t>(large.size()));
+  double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  start = std::chrono::steady_clock::now();
+  base::Crc32cPortable(large.data(), static_cast<int64_t>(large.size()));
+  double portable_seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  cout << "Throughput: " << (large.size() / seconds / 1e6) << " MB/s, "
+       << "portable " << (large.size() / portable_seconds / 1e6) << " MB/s"
+       << endl;
+
+  cout << "All passed: " << all_passed << endl;
+  return all_passed ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// Support for fuzz targets. Each target defines |LLVMFuzzerTestOneInput|,
+// the entry point used by libFuzzer, and may be linked either with
+// libFuzzer or with the standalone driver in "base/fuzz_main.cc", which
+// needs no special compiler support. Either way, targets are meant to be
+// built with AddressSanitizer and UndefinedBehaviorSanitizer, so that
+// memory errors are caught where they happen.
+//
+// A target returns normally for any input which the code under test
+// rejects. It calls |FUZZ_CHECK| for properties which must hold for every
+// input, such as a decoded round trip reproducing its text.
+
+#ifndef HUFFMAN_BASE_FUZZ_H_
+#define HUFFMAN_BASE_FUZZ_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+// Reports the failed condition and aborts, which both libFuzzer and the
+// standalone driver treat as a crash.
+#define FUZZ_CHECK(condition)                                         \
+  do {                                                                \
+    if (!(condition)) {                                               \
+      fprintf(stderr, "%s:%d: Check failed: %s\n", __FILE__, __LINE__, \
+              #condition);                                            \
+      abort();                                                        \
+    }                                                                 \
+  } while (0)
+
+namespace base {
+// Decoders which are given hostile input may legitimately be asked for
+// enormous outputs; a constant block may describe a terabyte. Targets pass
+// this to the decoders as their limit on the output, so that they find
+// errors rather than exhausting memory, and exercise the limits too.
+static constexpr int64_t kMaxFuzzOutput = int64_t{1} << 24;
+
+// Splits a fuzz input into the values a target needs. Reads past the end
+// give zero, so that every input is usable.
+class FuzzInput {
+ public:
+  FuzzInput(const uint8_t* data, size_t size)
+      : data_(data), size_(size) {}
+
+  uint8_t Byte() {
+    return (position_ < size_) ? data_[position_++] : 0;
+  }
+
+  // Returns a little-endian integer of |sizeof(T)| bytes.
+  template <typename T>
+  T Integer() {
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+      value |= static_cast<T>(Byte()) << (8 * i);
+    }
+    return value;
+  }
+
+  // Returns an integer in [0, |bound|), or zero if |bound| is zero.
+  uint64_t Below(uint64_t bound) {
+    return (bound == 0) ? 0 : Integer<uint64_t>() % bound;
+  }
+
+  // Returns a pointer to the bytes which have not yet been taken, and takes
+  // them all.
+  const uint8_t* Rest(size_t* size) {
+    const uint8_t* rest = data_ + position_;
+    *size = remaining();
+    position_ = size_;
+    return rest;
+  }
+
+  size_t remaining() const {
+    return size_ - position_;
+  }
+
+ private:
+  const uint8_t* data_;
+  size_t size_;
+  size_t position_ = 0;
+};
+}  // namespace base
+
+#endif  // HUFFMAN_BASE_FUZZ_H_
@@ -0,0 +1,253 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// A standalone driver for the fuzz targets, for machines without libFuzzer.
+// Its flags are named as libFuzzer's are, so that the same command runs a
+// target built either way:
+//
+//   build/huffman_fuzz -max_total_time=60 [corpus files or directories]
+//
+// Every input given on the command line is run once. Then, until the time
+// or the number of runs is exhausted, inputs are generated at random or by
+// mutating those given. The generator knows nothing of the formats; it is
+// the targets which turn bytes into structured input.
+//
+// If an input crashes the target, it is written to |crash-<run>| in the
+// working directory before the process dies, so that it can be replayed by
+// passing that file as the only argument.
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+
+#include "base/fuzz.h"
+
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+
+DEFINE_int64(max_total_time, 10, "Seconds for which to generate inputs");
+DEFINE_int64(runs, -1, "Generated inputs to run, or -1 for no limit");
+DEFINE_int64(max_len, 4096, "Largest generated input, in bytes");
+DEFINE_uint64(seed, 0, "Seed for the generator, or 0 to use the time");
+
+// Provided by the sanitizer runtimes, when they are linked, to run a
+// callback as they report an error.
+extern "C" void __sanitizer_set_death_callback(void (*callback)())
+    __attribute__((weak));
+
+// UBSan exits without running the death callback unless it aborts.
+extern "C" const char* __ubsan_default_options();
+extern "C" const char* __ubsan_default_options() {
+  return "abort_on_error=1:print_stacktrace=1";
+}
+
+namespace {
+// The input being run, so that it can be saved if the target crashes.
+const uint8_t* current_data = nullptr;
+size_t current_size = 0;
+char crash_path[64] = "crash";
+
+// Writes the current input out. Only async-signal-safe functions are
+// called, since this runs from a signal handler.
+void SaveCrash() {
+  if (current_data == nullptr) {
+    return;
+  }
+  int fd = open(crash_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0) {
+    ssize_t written = write(fd, current_data, current_size);
+    close(fd);
+    static const char kMessage[] = "Crashing input written to ";
+    written += write(STDERR_FILENO, kMessage, sizeof(kMessage) - 1);
+    written += write(STDERR_FILENO, crash_path, strlen(crash_path));
+    written += write(STDERR_FILENO, "\n", 1);
+  }
+  current_data = nullptr;
+}
+
+void OnSignal(int signal_number) {
+  SaveCrash();
+  signal(signal_number, SIG_DFL);
+  raise(signal_number);
+}
+
+void Run(const vector<uint8_t>& input, int64_t run) {
+  snprintf(crash_path, sizeof(crash_path), "crash-%lld",
+           static_cast<long long>(run));
+  // An empty vector may have no storage, but the target is always given a
+  // valid pointer.
+  static const uint8_t kEmpty = 0;
+  current_data = input.empty() ? &kEmpty : input.data();
+  current_size = input.size();
+  LLVMFuzzerTestOneInput(current_data, current_size);
+  current_data = nullptr;
+}
+
+// Appends the files at |path|, or in it if it is a directory, to |corpus|.
+void LoadCorpus(const string& path, vector<vector<uint8_t>>* corpus) {
+  struct stat info;
+  if (stat(path.c_str(), &info) != 0) {
+    cerr << "Cannot read " << path << endl;
+    return;
+  }
+  if (S_ISDIR(info.st_mode)) {
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr) {
+      return;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+      if (entry->d_name[0] != '.') {
+        LoadCorpus(path + "/" + entry->d_name, corpus);
+      }
+    }
+    closedir(dir);
+    return;
+  }
+  std::ifstream file(path, std::ios::binary);
+  corpus->emplace_back(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+}
+
+// Generates an input from nothing. Half are drawn from a small alphabet,
+// since coders behave differently on skewed data than on noise.
+void Generate(std::mt19937_64* rng, vector<uint8_t>* input) {
+  input->resize((*rng)() % (static_cast<uint64_t>(FLAGS_max_len) + 1));
+  uint64_t alphabet = ((*rng)() % 2 == 0) ? 256 : 1 + (*rng)() % 8;
+  uint8_t base = (*rng)();
+  for (auto& c : *input) {
+    c = base + (*rng)() % alphabet;
+  }
+}
+
+// Applies a few small edits to |input|.
+void Mutate(std::mt19937_64* rng, vector<uint8_t>* input) {
+  int edits = 1 + (*rng)() % 4;
+  for (int i = 0; i < edits; ++i) {
+    size_t size = input->size();
+    size_t at = (size == 0) ? 0 : (*rng)() % size;
+    auto position = input->begin() + static_cast<std::ptrdiff_t>(at);
+    switch ((*rng)() % 6) {
+      case 0:
+        if (size > 0) {
+          (*input)[at] ^= 1 << ((*rng)() % 8);
+        }
+        break;
+      case 1:
+        if (size > 0) {
+          (*input)[at] = (*rng)();
+        }
+        break;
+      case 2:
+        if (static_cast<int64_t>(size) < FLAGS_max_len) {
+          input->insert(position, static_cast<uint8_t>((*rng)()));
+        }
+        break;
+      case 3:
+        if (size > 0) {
+          input->erase(position);
+        }
+        break;
+      case 4:
+        input->resize(at);
+        break;
+      default:
+        // Repeats a run of bytes, which lengthens the codes it contains.
+        if (size > 0) {
+          size_t length = 1 + (*rng)() % std::min<size_t>(size - at, 64);
+          vector<uint8_t> run(position,
+                              position + static_cast<std::ptrdiff_t>(length));
+          size_t to = (*rng)() % (size + 1);
+          input->insert(input->begin() + static_cast<std::ptrdiff_t>(to),
+                        run.begin(), run.end());
+          if (static_cast<int64_t>(input->size()) > FLAGS_max_len) {
+            input->resize(static_cast<size_t>(FLAGS_max_len));
+          }
+        }
+        break;
+    }
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  gflags::SetUsageMessage("Runs a fuzz target. Usage:\n"
+                          "  " + string(argv[0]) + " [flags] [corpus...]");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (__sanitizer_set_death_callback != nullptr) {
+    __sanitizer_set_death_callback(SaveCrash);
+  }
+  signal(SIGABRT, OnSignal);
+  signal(SIGSEGV, OnSignal);
+  signal(SIGFPE, OnSignal);
+  signal(SIGBUS, OnSignal);
+
+  vector<vector<uint8_t>> corpus;
+  for (int i = 1; i < argc; ++i) {
+    LoadCorpus(argv[i], &corpus);
+  }
+
+  int64_t run = 0;
+  for (const auto& input : corpus) {
+    Run(input, run++);
+  }
+  cerr << "Replayed " << corpus.size() << " inputs" << endl;
+
+  uint64_t seed = FLAGS_seed;
+  if (seed == 0) {
+    seed = static_cast<uint64_t>(
+        std::chrono::system_clock::now().time_since_epoch().count());
+  }
+  cerr << "Seed: " << seed << endl;
+  std::mt19937_64 rng(seed);
+
+  auto start = std::chrono::steady_clock::now();
+  auto deadline = start + std::chrono::seconds(FLAGS_max_total_time);
+  int64_t generated = 0;
+  vector<uint8_t> input;
+  while (FLAGS_runs < 0 || generated < FLAGS_runs) {
+    // Reading the clock costs more than a small input.
+    if (generated % 64 == 0 &&
+        std::chrono::steady_clock::now() >= deadline) {
+      break;
+    }
+    if (!corpus.empty() && rng() % 2 == 0) {
+      input = corpus[rng() % corpus.size()];
+      Mutate(&rng, &input);
+    } else {
+      Generate(&rng, &input);
+      if (rng() % 2 == 0) {
+        Mutate(&rng, &input);
+      }
+    }
+    Run(input, run++);
+    ++generated;
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  cerr << "Done " << generated << " runs in " << elapsed.count()
+       << " seconds" << endl;
+  gflags::ShutDownCommandLineFlags();
+  return 0;
+}
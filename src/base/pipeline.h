@@ -0,0 +1,179 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// This class runs a read, code and write loop as three concurrent stages,
+// so that the disk and the CPU are kept busy at the same time. Throughput
+// approaches that of the slowest stage, rather than the sum of all three.
+//
+// Work is passed between the stages in chunks, of which there are a fixed
+// number. Each chunk cycles from the reader to the coder to the writer and
+// back to the reader, so that whatever storage a chunk holds is reused
+// rather than reallocated, and memory is bounded by the number of chunks.
+// Chunks are passed in order, so they are written in the order they were
+// read. The stages are connected by |SpscQueue|s.
+//
+// The reader and coder each run on their own thread. The writer runs on the
+// thread which calls |Run|.
+
+#ifndef HUFFMAN_BASE_PIPELINE_H_
+#define HUFFMAN_BASE_PIPELINE_H_
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "base/spsc_queue.h"
+
+namespace base {
+template <typename Chunk>
+class Pipeline {
+ public:
+  typedef std::function<bool(Chunk*)> Stage;
+
+  // |depth| chunks, which must be at least one, are shared by the stages.
+  explicit Pipeline(int depth)
+      : chunks_(static_cast<size_t>(depth)),
+        free_(static_cast<size_t>(depth)),
+        read_(static_cast<size_t>(depth) + 1),
+        coded_(static_cast<size_t>(depth) + 1) {}
+
+  // Runs the stages until |read| returns false, which marks the end of the
+  // input. Chunks already read are still coded and written.
+  //
+  // If |code| returns false, nothing more is read or coded, but the chunks
+  // coded before it are still written. If |write| returns false, nothing
+  // more is read, coded or written.
+  //
+  // Returns true if and only if every chunk was coded and written.
+  bool Run(const Stage& read, const Stage& code, const Stage& write);
+
+ private:
+  Pipeline(const Pipeline&) = delete;
+  Pipeline& operator=(const Pipeline&) = delete;
+
+  // These wait until the operation succeeds, or return false if the
+  // pipeline has been stopped. A null chunk marks the end of the input.
+  bool Push(SpscQueue<Chunk*>* queue, Chunk* chunk);
+  bool Pop(SpscQueue<Chunk*>* queue, Chunk** chunk);
+
+  std::vector<Chunk> chunks_;
+  SpscQueue<Chunk*> free_;    // From the writer to the reader
+  SpscQueue<Chunk*> read_;    // From the reader to the coder
+  SpscQueue<Chunk*> coded_;   // From the coder to the writer
+  std::atomic<bool> stopped_{false};
+};  // class Pipeline
+
+namespace pipeline_internal {
+static constexpr int kBackoffSpins = 64;
+static constexpr int kBackoffSleepMicros = 50;
+
+// Waits for a queue by spinning briefly, in case the other stage is about to
+// catch up, and then by sleeping, so that a stage waiting on the disk does
+// not occupy a core.
+class Backoff {
+ public:
+  void Wait() {
+    // The count stops at the limit, so that a long wait cannot overflow it.
+    if (tries_ < kBackoffSpins) {
+      ++tries_;
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(
+          std::chrono::microseconds(kBackoffSleepMicros));
+    }
+  }
+
+ private:
+  int tries_ = 0;
+};
+}  // namespace pipeline_internal
+
+template <typename Chunk>
+bool Pipeline<Chunk>::Push(SpscQueue<Chunk*>* queue, Chunk* chunk) {
+  pipeline_internal::Backoff backoff;
+  while (!queue->TryPush(chunk)) {
+    if (stopped_) {
+      return false;
+    }
+    backoff.Wait();
+  }
+  return true;
+}
+
+template <typename Chunk>
+bool Pipeline<Chunk>::Pop(SpscQueue<Chunk*>* queue, Chunk** chunk) {
+  pipeline_internal::Backoff backoff;
+  while (!queue->TryPop(chunk)) {
+    // A chunk pushed just before the pipeline was stopped is still taken.
+    if (stopped_) {
+      return queue->TryPop(chunk);
+    }
+    backoff.Wait();
+  }
+  return true;
+}
+
+template <typename Chunk>
+bool Pipeline<Chunk>::Run(const Stage& read, const Stage& code,
+                          const Stage& write) {
+  stopped_ = false;
+  for (auto it = chunks_.begin(); it != chunks_.end(); ++it) {
+    free_.TryPush(&*it);
+  }
+
+  std::thread reader([this, &read]() {
+    Chunk* chunk;
+    while (Pop(&free_, &chunk)) {
+      if (!read(chunk)) {
+        Push(&read_, nullptr);
+        return;
+      }
+      if (!Push(&read_, chunk)) return;
+    }
+  });
+
+  std::thread coder([this, &code]() {
+    Chunk* chunk;
+    while (Pop(&read_, &chunk)) {
+      if (chunk == nullptr) {
+        Push(&coded_, nullptr);
+        return;
+      }
+      if (!code(chunk)) {
+        stopped_ = true;
+        return;
+      }
+      if (!Push(&coded_, chunk)) return;
+    }
+  });
+
+  bool success = false;
+  Chunk* chunk;
+  while (Pop(&coded_, &chunk)) {
+    if (chunk == nullptr) {
+      success = true;
+      break;
+    }
+    if (!write(chunk)) {
+      break;
+    }
+    Push(&free_, chunk);
+  }
+  // Whether the input ended or a stage failed, the other stages have either
+  // finished or must now be told to stop.
+  stopped_ = true;
+
+  reader.join();
+  coder.join();
+
+  // The queues are emptied, so that the pipeline may be run again.
+  while (free_.TryPop(&chunk)) {}
+  while (read_.TryPop(&chunk)) {}
+  while (coded_.TryPop(&chunk)) {}
+  return success;
+}
+}  // namespace base
+
+#endif  // HUFFMAN_BASE_PIPELINE_H_
@@ -0,0 +1,129 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// Unit test for the SPSC queue and the three-stage pipeline
+
+#include <cstdint>
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "base/pipeline.h"
+#include "base/spsc_queue.h"
+
+using std::cout;
+using std::endl;
+using std::vector;
+
+namespace {
+struct Chunk {
+  vector<int64_t> values = {};
+};
+
+// Passes a counter through a small queue from one thread to another, and
+// checks that every value arrives once and in order.
+bool TestQueue() {
+  static constexpr int64_t kCount = 1000000;
+
+  base::SpscQueue<int64_t> queue(7);
+  bool sane = (queue.capacity() == 7);
+
+  std::thread producer([&queue]() {
+    for (int64_t i = 0; i < kCount; ++i) {
+      while (!queue.TryPush(i)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  for (int64_t i = 0; i < kCount; ++i) {
+    int64_t value;
+    while (!queue.TryPop(&value)) {
+      std::this_thread::yield();
+    }
+    sane &= (value == i);
+  }
+  producer.join();
+
+  int64_t value;
+  sane &= !queue.TryPop(&value);
+  cout << "Queue: " << sane << endl;
+  return sane;
+}
+
+// Runs |count| chunks through a pipeline of |depth| whose coder fails on
+// the chunk numbered |fail_at|, if any. Checks that the chunks are written
+// in order, that every chunk is written if none failed, and that the
+// storage of the chunks is reused.
+bool TestPipeline(int depth, int64_t count, int64_t fail_at) {
+  base::Pipeline<Chunk> pipeline(depth);
+
+  int64_t next_read = 0;
+  int64_t next_written = 0;
+  std::atomic<int64_t> allocations(0);
+  bool ordered = true;
+
+  bool success = pipeline.Run(
+      [&](Chunk* chunk) {
+        if (next_read == count) return false;
+        if (chunk->values.capacity() == 0) {
+          chunk->values.reserve(1);
+          ++allocations;
+        }
+        chunk->values.assign(1, next_read++);
+        return true;
+      },
+      [fail_at](Chunk* chunk) {
+        if (chunk->values[0] == fail_at) return false;
+        chunk->values[0] *= 2;
+        return true;
+      },
+      [&](Chunk* chunk) {
+        ordered &= (chunk->values[0] == 2 * next_written++);
+        return true;
+      });
+
+  bool sane = ordered && allocations <= depth;
+  if (fail_at < 0) {
+    sane &= success && next_written == count;
+  } else {
+    sane &= !success && next_written <= fail_at;
+  }
+  cout << "Pipeline of depth " << depth << ", " << count << " chunks"
+       << (fail_at < 0 ? "" : ", failing") << ": " << sane << endl;
+  return sane;
+}
+
+// Checks that a failure in the writer stops the other stages.
+bool TestWriteFailure() {
+  base::Pipeline<Chunk> pipeline(3);
+
+  int64_t written = 0;
+  bool success = pipeline.Run(
+      [](Chunk* chunk) {
+        chunk->values.assign(1, 0);
+        return true;  // The input never ends on its own.
+      },
+      [](Chunk*) { return true; },
+      [&written](Chunk*) { return ++written != 10; });
+
+  bool sane = !success && written == 10;
+  cout << "Write failure: " << sane << endl;
+  return sane;
+}
+}  // namespace
+
+int main() {
+  bool all_passed = true;
+  all_passed &= TestQueue();
+  all_passed &= TestPipeline(1, 0, -1);
+  all_passed &= TestPipeline(1, 1000, -1);
+  all_passed &= TestPipeline(4, 100000, -1);
+  all_passed &= TestPipeline(4, 100000, 5000);
+  all_passed &= TestWriteFailure();
+
+  cout << "All passed: " << all_passed << endl;
+  return all_passed ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// This class is a bounded queue for passing values from exactly one producer
+// thread to exactly one consumer thread without locking. It is a ring buffer
+// in which only the producer advances the head and only the consumer
+// advances the tail, so each index has a single writer and an acquire/
+// release pair on it suffices to publish the slot it guards.
+//
+// Neither operation blocks. Callers which must wait should retry, backing
+// off as they see fit.
+
+#ifndef HUFFMAN_BASE_SPSC_QUEUE_H_
+#define HUFFMAN_BASE_SPSC_QUEUE_H_
+
+#include <cstddef>
+
+#include <atomic>
+#include <vector>
+
+namespace base {
+template <typename T>
+class SpscQueue {
+ public:
+  // One slot is always left empty, so that a full ring can be told apart
+  // from an empty one.
+  explicit SpscQueue(size_t capacity) : slots_(capacity + 1) {}
+
+  // Producer only. Returns false, leaving |value| unused, if the queue is full.
+  bool TryPush(const T& value) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t next = Next(head);
+    if (next == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    slots_[head] = value;
+    head_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only. Returns false if the queue is empty.
+  bool TryPop(T* value) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    *value = slots_[tail];
+    tail_.store(Next(tail), std::memory_order_release);
+    return true;
+  }
+
+  size_t capacity() const {
+    return slots_.size() - 1;
+  }
+
+ private:
+  static constexpr size_t kCacheLineSize = 64;
+
+  size_t Next(size_t index) const {
+    return index + 1 == slots_.size() ? 0 : index + 1;
+  }
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  std::vector<T> slots_;
+
+  // The indices are kept on separate cache lines, so that the producer and
+  // consumer do not invalidate each other's line on every operation.
+  char pad0_[kCacheLineSize];
+  std::atomic<size_t> head_{0};
+  char pad1_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> tail_{0};
+  char pad2_[kCacheLineSize - sizeof(std::atomic<size_t>)];
+};  // class SpscQueue
+}  // namespace base
+
+#endif  // HUFFMAN_BASE_SPSC_QUEUE_H_
@@ -0,0 +1,117 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+
+#include "base/stats.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <atomic>
+#include <new>
+#include <sstream>
+#include <string>
+
+namespace base {
+namespace stats {
+namespace {
+static const char* const kStageNames[kNumStages] = {
+  "read", "histogram", "tree", "map", "encode", "decode", "serialize",
+  "checksum", "write",
+};
+
+static const char* const kCounterNames[kNumCounters] = {
+  "bytes_in", "bytes_out", "symbols", "coded_bits", "max_code_length",
+  "allocations", "allocated_bytes",
+};
+
+// Stages may be timed from several threads at once, so every field is
+// atomic. Relaxed ordering suffices, as the values are only ever summed.
+struct StageTimes {
+  std::atomic<uint64_t> calls;
+  std::atomic<uint64_t> cycles;
+  std::atomic<uint64_t> ns;
+};
+
+StageTimes stages[kNumStages];
+std::atomic<uint64_t> counters[kNumCounters];
+}  // namespace
+
+void AddTime(Stage stage, uint64_t cycles, uint64_t ns) {
+  stages[stage].calls.fetch_add(1, std::memory_order_relaxed);
+  stages[stage].cycles.fetch_add(cycles, std::memory_order_relaxed);
+  stages[stage].ns.fetch_add(ns, std::memory_order_relaxed);
+}
+
+void Add(Counter counter, uint64_t value) {
+  counters[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+void Max(Counter counter, uint64_t value) {
+  uint64_t current = counters[counter].load(std::memory_order_relaxed);
+  while (current < value &&
+         !counters[counter].compare_exchange_weak(
+             current, value, std::memory_order_relaxed)) {}
+}
+
+void Reset() {
+  for (int i = 0; i < kNumStages; ++i) {
+    stages[i].calls = 0;
+    stages[i].cycles = 0;
+    stages[i].ns = 0;
+  }
+  for (int i = 0; i < kNumCounters; ++i) {
+    counters[i] = 0;
+  }
+}
+
+std::string ToJson() {
+  std::ostringstream json;
+#ifdef HUFFMAN_STATS
+  json << "{\"enabled\": true, \"stages\": {";
+  for (int i = 0; i < kNumStages; ++i) {
+    json << (i == 0 ? "" : ", ") << "\"" << kStageNames[i] << "\": {"
+         << "\"calls\": " << stages[i].calls << ", "
+         << "\"cycles\": " << stages[i].cycles << ", "
+         << "\"ns\": " << stages[i].ns << "}";
+  }
+  json << "}";
+  for (int i = 0; i < kNumCounters; ++i) {
+    json << ", \"" << kCounterNames[i] << "\": " << counters[i];
+  }
+
+  uint64_t symbols = counters[kSymbols];
+  json << ", \"bits_per_symbol\": "
+       << (symbols == 0 ? 0.0 :
+           static_cast<double>(counters[kCodedBits]) / symbols)
+       << "}";
+#else
+  json << "{\"enabled\": false}";
+#endif  // HUFFMAN_STATS
+  return json.str();
+}
+}  // namespace stats
+}  // namespace base
+
+#ifdef HUFFMAN_STATS
+void* operator new(size_t size) {
+  base::stats::Add(base::stats::kAllocations, 1);
+  base::stats::Add(base::stats::kAllocatedBytes, size);
+  void* ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  free(ptr);
+}
+#endif  // HUFFMAN_STATS
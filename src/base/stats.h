@@ -0,0 +1,116 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// These are process-wide counters for finding where the time of a job goes.
+// Each stage of coding records the wall time and, on x86-64, the cycles
+// spent in it, and the codec records the bytes and symbols it processes.
+//
+// Statistics are only collected if |HUFFMAN_STATS| is defined. Otherwise
+// the macros below expand to nothing, so instrumented code is exactly as
+// fast as it would be without them. |ToJson| may be called either way.
+//
+// When statistics are enabled, the global |operator new| is also replaced
+// so that allocations can be counted.
+
+#ifndef HUFFMAN_BASE_STATS_H_
+#define HUFFMAN_BASE_STATS_H_
+
+#include <cstdint>
+
+#include <chrono>
+#include <string>
+
+#if defined(HUFFMAN_STATS) && defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+namespace base {
+namespace stats {
+enum Stage {
+  kReadStage,
+  kHistogramStage,
+  kTreeStage,
+  kMapStage,
+  kEncodeStage,
+  kDecodeStage,
+  kSerializeStage,
+  kChecksumStage,
+  kWriteStage,
+  kNumStages,
+};
+
+enum Counter {
+  kBytesIn,         // Bytes read by the archiver
+  kBytesOut,        // Bytes written by the archiver
+  kSymbols,         // Symbols entropy coded or decoded
+  kCodedBits,       // Bits those symbols were coded in
+  kMaxCodeLength,   // The longest code of any tree built
+  kAllocations,
+  kAllocatedBytes,
+  kNumCounters,
+};
+
+// Records one call to |stage| which took |cycles| and |ns|.
+void AddTime(Stage stage, uint64_t cycles, uint64_t ns);
+
+// Adds |value| to |counter|, or raises |counter| to at least |value|.
+void Add(Counter counter, uint64_t value);
+void Max(Counter counter, uint64_t value);
+
+// Resets every stage and counter to zero.
+void Reset();
+
+// Returns every stage and counter as a JSON object. If statistics were
+// compiled out, the object only records that they are disabled.
+std::string ToJson();
+
+#ifdef HUFFMAN_STATS
+// Returns the time stamp counter, or |0| where there is none.
+inline uint64_t Cycles() {
+#ifdef __x86_64__
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// Records the time from its construction to its destruction against a stage.
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(Stage stage)
+      : stage_(stage), cycles_(Cycles()),
+        start_(std::chrono::steady_clock::now()) {}
+
+  ~ScopedTimer() {
+    uint64_t cycles = Cycles() - cycles_;
+    AddTime(stage_, cycles, static_cast<uint64_t>(std::chrono::duration_cast<
+        std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_)
+        .count()));
+  }
+
+ private:
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+  Stage stage_;
+  uint64_t cycles_;
+  std::chrono::steady_clock::time_point start_;
+};
+#endif  // HUFFMAN_STATS
+}  // namespace stats
+}  // namespace base
+
+#ifdef HUFFMAN_STATS
+#define STATS_TIMER(stage) \
+  ::base::stats::ScopedTimer stats_timer_(::base::stats::stage)
+#define STATS_ADD(counter, value) \
+  ::base::stats::Add(::base::stats::counter, (value))
+#define STATS_MAX(counter, value) \
+  ::base::stats::Max(::base::stats::counter, (value))
+#else
+#define STATS_TIMER(stage) do {} while (false)
+#define STATS_ADD(counter, value) do {} while (false)
+#define STATS_MAX(counter, value) do {} while (false)
+#endif  // HUFFMAN_STATS
+
+#endif  // HUFFMAN_BASE_STATS_H_
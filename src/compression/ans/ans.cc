@@ -0,0 +1,427 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+
+#include "compression/ans/ans.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <vector>
+
+#include "compression/histogram.h"
+
+#include "base/bitstring.h"
+#include "base/stats.h"
+
+using std::vector;
+
+namespace compression {
+namespace ans {
+namespace {
+static constexpr int kTableLog = Ans::kTableLog;
+static constexpr uint32_t kTableSize = Ans::kTableSize;
+
+// The step between the slots given to successive states when spreading
+// symbols across the table. Being odd, it visits every slot exactly once,
+// and it scatters the slots of each symbol across the whole range of states.
+static constexpr uint32_t kSpreadStep =
+    (kTableSize >> 1) + (kTableSize >> 3) + 3;
+
+// The bits of four symbols and the leftover bits of a partial byte fit in
+// the 64-bit accumulator of the encoder.
+static constexpr int kSymbolsPerFlush = 4;
+
+int FloorLog2(uint32_t value) {
+  int log = 0;
+  while (value >>= 1) {
+    ++log;
+  }
+  return log;
+}
+
+uint64_t LoadLittleEndian(const uint8_t* bytes) {
+  uint64_t value;
+  memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+// Writes the low |num_bits| bits of each value after those already written,
+// least significant bit first. |Flush| stores a whole word at a time, so
+// the buffer must have |sizeof(uint64_t)| bytes of slack past the last byte
+// written.
+class BitWriter {
+ public:
+  explicit BitWriter(uint8_t* out) : begin_(out), out_(out) {}
+
+  void Write(uint64_t value, int num_bits) {
+    acc_ |= value << count_;
+    count_ += num_bits;
+  }
+
+  void Flush() {
+    memcpy(out_, &acc_, sizeof(acc_));
+    out_ += count_ >> 3;
+    acc_ >>= count_ & ~7;
+    count_ &= 7;
+  }
+
+  // Flushes, and returns the number of bytes written.
+  int64_t Finish() {
+    Flush();
+    return (out_ - begin_) + (count_ > 0);
+  }
+
+ private:
+  uint8_t* begin_;
+  uint8_t* out_;
+  uint64_t acc_ = 0;
+  int count_ = 0;
+};
+
+// Reads the bits written by |BitWriter| in reverse, beginning just below the
+// position |num_bits|. Reads which would pass the start of the buffer fail.
+class ReverseBitReader {
+ public:
+  ReverseBitReader(const uint8_t* bytes, int64_t size, int64_t num_bits)
+      : bytes_(bytes), size_(size), position_(num_bits) {}
+
+  // Checks bounds, and reads the bytes one at a time, so that it is safe at
+  // either end of the buffer.
+  bool Read(int num_bits, uint32_t* value) {
+    if (position_ < num_bits) {
+      return false;
+    }
+    position_ -= num_bits;
+    int64_t byte = position_ >> 3;
+    uint32_t word = 0;
+    for (int i = 2; i >= 0; --i) {
+      word = (word << 8) | ((byte + i < size_) ? bytes_[byte + i] : 0);
+    }
+    *value = (word >> (position_ & 7)) & ((1u << num_bits) - 1);
+    return true;
+  }
+
+  // Reads with a single unaligned load. The caller must ensure that
+  // |position()| is at least |num_bits| and at most |fast_limit()|.
+  uint32_t ReadFast(int num_bits) {
+    position_ -= num_bits;
+    uint64_t word = LoadLittleEndian(bytes_ + (position_ >> 3));
+    return (word >> (position_ & 7)) & ((1u << num_bits) - 1);
+  }
+
+  // The highest position from which |ReadFast| may read without loading
+  // past the end of the buffer.
+  int64_t fast_limit() const {
+    return 8 * (size_ - static_cast<int64_t>(sizeof(uint64_t)));
+  }
+
+  int64_t position() const {
+    return position_;
+  }
+
+ private:
+  const uint8_t* bytes_;
+  int64_t size_;
+  int64_t position_;
+};
+}  // namespace
+
+void Ans::BuildTable(const void* text, int64_t size) {
+  vector<uint64_t> histogram;
+  BuildHistogram(text, size, &histogram);
+  this->BuildTable(histogram);
+}
+
+void Ans::BuildTable(const vector<uint64_t>& histogram) {
+  ScaleHistogram(histogram, &histogram_, &symbol_count_);
+  this->BuildTable();
+}
+
+void Ans::Normalize() {
+  uint64_t total = 0;
+  for (auto it = histogram_.cbegin(); it != histogram_.cend(); ++it) {
+    total += *it;
+  }
+
+  norm_.assign(base::kMaxByte, 0);
+  if (total == 0) {
+    return;
+  }
+  const uint32_t* histogram = histogram_.data();
+  uint32_t* norm = norm_.data();
+
+  int64_t sum = 0;
+  for (int i = 0; i < base::kMaxByte; ++i) {
+    if (histogram[i] > 0) {
+      uint64_t scaled = (uint64_t{histogram[i]} * kTableSize + total / 2) /
+          total;
+      norm[i] = (scaled > 0) ? scaled : 1;
+      sum += norm[i];
+    }
+  }
+
+  // Giving a state to a symbol with count |c| and |n| states saves about
+  // |c/n| bits, and taking one away costs about |c/(n-1)|. The comparisons
+  // are cross-multiplied, so that the encoder and decoder agree exactly.
+  while (sum < kTableSize) {
+    int best = -1;
+    for (int i = 0; i < base::kMaxByte; ++i) {
+      if (norm[i] > 0 && (best < 0 ||
+          uint64_t{histogram[i]} * norm[best] >
+              uint64_t{histogram[best]} * norm[i])) {
+        best = i;
+      }
+    }
+    ++norm[best];
+    ++sum;
+  }
+  while (sum > kTableSize) {
+    int best = -1;
+    for (int i = 0; i < base::kMaxByte; ++i) {
+      if (norm[i] > 1 && (best < 0 ||
+          uint64_t{histogram[i]} * (norm[best] - 1) <
+              uint64_t{histogram[best]} * (norm[i] - 1))) {
+        best = i;
+      }
+    }
+    --norm[best];
+    --sum;
+  }
+}
+
+void Ans::BuildTable() {
+  Normalize();
+
+  transforms_.assign(base::kMaxByte, SymbolTransform{0, 0});
+  state_table_.clear();
+  decode_table_.clear();
+  if (std::all_of(norm_.cbegin(), norm_.cend(),
+                  [](uint32_t n) { return n == 0; })) {
+    return;
+  }
+  const uint32_t* norm = norm_.data();
+  SymbolTransform* transforms = transforms_.data();
+
+  // Each symbol is given |norm[s]| slots, visited in the order of
+  // |kSpreadStep|. Position zero is reached again after the last slot.
+  vector<uint8_t> spread(kTableSize);
+  uint32_t position = 0;
+  for (int s = 0; s < base::kMaxByte; ++s) {
+    for (uint32_t i = 0; i < norm[s]; ++i) {
+      spread[position] = s;
+      position = (position + kSpreadStep) & (kTableSize - 1);
+    }
+  }
+  assert(position == 0);
+
+  // The encoder states for symbol |s| are listed from |cumulative[s]|, in
+  // the order of their slots. A state |x| in |[kTableSize, 2*kTableSize)|
+  // is reduced to |x >> num_bits| in |[norm, 2*norm)| before the lookup.
+  uint32_t cumulative[base::kMaxByte + 1] = {};
+  for (int s = 0; s < base::kMaxByte; ++s) {
+    cumulative[s + 1] = cumulative[s] + norm[s];
+
+    if (norm[s] == 1) {
+      transforms[s].delta_bits = (kTableLog << 16) - kTableSize;
+    } else if (norm[s] > 1) {
+      uint32_t max_bits =
+          static_cast<uint32_t>(kTableLog - FloorLog2(norm[s] - 1));
+      transforms[s].delta_bits = (max_bits << 16) - (norm[s] << max_bits);
+    }
+    transforms[s].delta_state = static_cast<int32_t>(cumulative[s]) -
+        static_cast<int32_t>(norm[s]);
+  }
+
+  state_table_.resize(kTableSize);
+  decode_table_.resize(kTableSize);
+  uint32_t next[base::kMaxByte];
+  for (int s = 0; s < base::kMaxByte; ++s) {
+    next[s] = norm[s];
+  }
+  for (uint32_t u = 0; u < kTableSize; ++u) {
+    uint8_t s = spread[u];
+    state_table_[cumulative[s] + next[s] - norm[s]] = kTableSize + u;
+
+    // The decoder reverses this: the |k|th slot of |s| was reached from
+    // the reduced state |norm + k|, whose low bits were written out.
+    uint32_t reduced = next[s]++;
+    int num_bits = kTableLog - FloorLog2(reduced);
+    decode_table_[u].base = (reduced << num_bits) - kTableSize;
+    decode_table_[u].symbol = s;
+    decode_table_[u].num_bits = num_bits;
+  }
+}
+
+void Ans::Encode(const void* text, int64_t size,
+                 void** buffer, int64_t* buffer_size) const {
+  STATS_TIMER(kEncodeStage);
+  const uint8_t* values_ptr = reinterpret_cast<const uint8_t*>(text);
+  assert(size == 0 || !state_table_.empty());
+
+  // Every symbol costs at most |kTableLog| bits.
+  int64_t capacity = (size * kTableLog + 2 * kTableLog + 1 + 7) / 8 +
+      static_cast<int64_t>(sizeof(uint64_t));
+  uint8_t* out = new uint8_t[capacity];
+  BitWriter writer(out);
+
+  const SymbolTransform* transforms = transforms_.data();
+  const uint16_t* state_table = state_table_.data();
+  uint32_t states[2] = {kTableSize, kTableSize};
+
+  auto encode = [&](uint8_t symbol, uint32_t* state) {
+    const SymbolTransform& transform = transforms[symbol];
+    int num_bits = static_cast<int>((*state + transform.delta_bits) >> 16);
+    writer.Write(*state & ((1u << num_bits) - 1), num_bits);
+    *state = state_table[static_cast<int32_t>(*state >> num_bits) +
+                         transform.delta_state];
+  };
+
+  // Symbol |i| is coded by state |i % 2|, from the last symbol to the first.
+  int64_t i = size;
+  if (i % 2 == 1) {
+    --i;
+    encode(values_ptr[i], &states[0]);
+    writer.Flush();
+  }
+  for (; i >= kSymbolsPerFlush; i -= kSymbolsPerFlush) {
+    encode(values_ptr[i - 1], &states[1]);
+    encode(values_ptr[i - 2], &states[0]);
+    encode(values_ptr[i - 3], &states[1]);
+    encode(values_ptr[i - 4], &states[0]);
+    writer.Flush();
+  }
+  for (; i >= 2; i -= 2) {
+    encode(values_ptr[i - 1], &states[1]);
+    encode(values_ptr[i - 2], &states[0]);
+    writer.Flush();
+  }
+
+  writer.Write(states[0] - kTableSize, kTableLog);
+  writer.Write(states[1] - kTableSize, kTableLog);
+  writer.Write(1, 1);
+  *buffer_size = writer.Finish();
+  *buffer = out;
+  STATS_ADD(kSymbols, static_cast<uint64_t>(size));
+  STATS_ADD(kCodedBits, static_cast<uint64_t>(8 * *buffer_size));
+}
+
+bool Ans::Decode(const void* bytes, int64_t size,
+                 void** data, int64_t* data_size, int64_t max_size) const {
+  STATS_TIMER(kDecodeStage);
+  *data = nullptr;
+  const uint8_t* byte_ptr = reinterpret_cast<const uint8_t*>(bytes);
+  if (size < 1 || byte_ptr[size - 1] == 0) {
+    return false;
+  }
+  if (max_size < 0 || symbol_count_ > static_cast<uint64_t>(max_size)) {
+    return false;
+  }
+  if (symbol_count_ > 0 && decode_table_.empty()) {
+    return false;
+  }
+
+  // The marker is the highest set bit of the last byte.
+  ReverseBitReader reader(byte_ptr, size,
+                          8 * (size - 1) + FloorLog2(byte_ptr[size - 1]));
+  uint32_t states[2];
+  if (!reader.Read(kTableLog, &states[1]) ||
+      !reader.Read(kTableLog, &states[0])) {
+    return false;
+  }
+
+  int64_t count = static_cast<int64_t>(symbol_count_);
+  uint8_t* out = new uint8_t[count];
+  const DecodeEntry* table = decode_table_.data();
+
+  auto decode_safe = [&](int64_t i) {
+    uint32_t* state = &states[i % 2];
+    const DecodeEntry& entry = table[*state];
+    out[i] = entry.symbol;
+    uint32_t low_bits;
+    if (!reader.Read(entry.num_bits, &low_bits)) {
+      return false;
+    }
+    *state = entry.base + low_bits;
+    return true;
+  };
+
+  // Near the end of the buffer, where a word cannot be loaded, and near the
+  // start, where the bits may run out, every read is checked. Between them
+  // two symbols are decoded at a time, one from each state.
+  int64_t i = 0;
+  bool ok = true;
+  while (ok && i < count && reader.position() > reader.fast_limit()) {
+    ok = decode_safe(i++);
+  }
+  if (ok && i % 2 == 1 && i < count) {
+    ok = decode_safe(i++);
+  }
+  uint32_t state0 = states[0];
+  uint32_t state1 = states[1];
+  for (; ok && count - i >= 2 && reader.position() >= 2 * kTableLog;
+       i += 2) {
+    const DecodeEntry entry0 = table[state0];
+    out[i] = entry0.symbol;
+    state0 = entry0.base + reader.ReadFast(entry0.num_bits);
+
+    const DecodeEntry entry1 = table[state1];
+    out[i + 1] = entry1.symbol;
+    state1 = entry1.base + reader.ReadFast(entry1.num_bits);
+  }
+  states[0] = state0;
+  states[1] = state1;
+  while (ok && i < count) {
+    ok = decode_safe(i++);
+  }
+
+  // The encoder began from the first state in each, and every bit must
+  // have been consumed.
+  if (!ok || reader.position() != 0 || states[0] != 0 || states[1] != 0) {
+    delete[] out;
+    return false;
+  }
+  *data = out;
+  *data_size = count;
+  STATS_ADD(kSymbols, symbol_count_);
+  STATS_ADD(kCodedBits, static_cast<uint64_t>(8 * size));
+  return true;
+}
+
+uint64_t Ans::CodedBits(const vector<uint64_t>& histogram) const {
+  assert(histogram.size() == base::kMaxByte);
+
+  double num_bits = 2 * kTableLog + 1;
+  for (size_t i = 0; i < histogram.size(); ++i) {
+    if (histogram[i] > 0) {
+      if (norm_[i] == 0) {
+        return UINT64_MAX;
+      }
+      num_bits += histogram[i] * (kTableLog - std::log2(norm_[i]));
+    }
+  }
+  return static_cast<uint64_t>(std::ceil(num_bits));
+}
+
+void Ans::Serialize(void** buffer, int64_t* size) const {
+  *size = SerializedSize();
+  uint8_t* working_buf = new uint8_t[*size];
+  WriteHistogram(histogram_, symbol_count_, working_buf);
+  *buffer = working_buf;
+}
+
+bool Ans::Unserialize(const void* bytes, int64_t size) {
+  if (!ReadHistogram(bytes, size, &histogram_, &symbol_count_)) {
+    return false;
+  }
+  this->BuildTable();
+  return true;
+}
+
+int64_t Ans::SerializedSize() const {
+  return HistogramSize(histogram_, symbol_count_);
+}
+}  // namespace ans
+}  // namespace compression
@@ -0,0 +1,147 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// This class encodes and decodes strings using table-based asymmetric
+// numeral systems (tANS), in the manner of Finite State Entropy.
+//
+// A Huffman code spends a whole number of bits on every symbol, so a symbol
+// with a probability of 0.95 still costs one bit rather than 0.074. tANS
+// carries the fraction of a bit from one symbol to the next in a state of
+// |kTableLog| bits, and so codes within a small fraction of the entropy,
+// while decoding with a single table lookup per symbol.
+//
+// The code is derived from the same histogram as |huffman::Huffman|, which
+// is serialized in the same format. Each count is first normalized so that
+// the counts sum to |kTableSize|, every symbol which occurs keeping at least
+// one slot, and the slots are then spread across the table.
+//
+// The coded form is a sequence of bytes holding the bits of every symbol,
+// least significant bit first. It is followed by the final values of the
+// two coding states, |kTableLog| bits each, and by a single set bit which
+// marks its end. Symbols are coded in reverse, so that they can be decoded
+// forwards while the bits are read backwards from the marker. Alternate
+// symbols use alternate states, so that the decoder can work on two at once.
+//
+// Usage:
+//
+//   Ans ans;
+//   ans.BuildTable(histogram);
+//   ans.Encode(text, size, &buffer, &buffer_size);
+//
+//   Ans other;
+//   other.Unserialize(header, header_size);
+//   other.Decode(buffer, buffer_size, &text, &size, max_size);
+
+#ifndef HUFFMAN_COMPRESSION_ANS_ANS_H_
+#define HUFFMAN_COMPRESSION_ANS_ANS_H_
+
+#include <cstdint>
+
+#include <vector>
+
+namespace compression {
+namespace ans {
+class Ans {
+ public:
+  // The base two logarithm of the number of states, and so of the sum of
+  // the normalized counts. A larger table approximates the histogram more
+  // closely, but no longer fits in the fastest cache.
+  static constexpr int kTableLog = 12;
+  static constexpr int kTableSize = 1 << kTableLog;
+
+  Ans() {}
+
+  // These build the coding tables for the |size| bytes at |text|, or from
+  // a histogram which has already been computed by the caller. |histogram|
+  // must have |base::kMaxByte| entries. As with |huffman::Huffman|, counts
+  // too large for 32 bits are scaled down.
+  void BuildTable(const void* text, int64_t size);
+  void BuildTable(const std::vector<uint64_t>& histogram);
+
+  // NOTE: These functions must be called AFTER |BuildTable| or |Unserialize|
+  //
+  // |Encode| codes the |size| bytes at |text| as described above into a
+  // newly allocated buffer. Every byte of |text| must occur in the
+  // histogram from which the table was built.
+  // NOTE: the calling context is responsible for deleting this pointer
+  //
+  // |Decode| decodes |symbol_count()| symbols from the |size| bytes at
+  // |bytes| into a newly allocated buffer of exactly that size. Returns true
+  // if and only if the coded form was well-formed and consumed exactly; on
+  // failure, |*data| is nullptr. A symbol can be coded in no bits at all,
+  // so the size of the coded form does not bound the count, which comes
+  // from an untrusted header; a count greater than |max_size| is rejected
+  // before anything is allocated.
+  // NOTE: the calling context is responsible for deleting this pointer
+  void Encode(const void* text, int64_t size,
+              void** buffer, int64_t* buffer_size) const;
+  bool Decode(const void* bytes, int64_t size,
+              void** data, int64_t* data_size, int64_t max_size) const;
+
+  // Returns an estimate of the number of bits which |Encode| will write for
+  // any text whose histogram is |histogram|, from the cost of each symbol
+  // under the normalized counts. Returns |UINT64_MAX| if the text contains
+  // a symbol which does not occur in this table's histogram.
+  uint64_t CodedBits(const std::vector<uint64_t>& histogram) const;
+
+  // These write and read the histogram in the format described in
+  // "compression/histogram.h", from which the tables can be rebuilt.
+  // |SerializedSize| returns the number of bytes which |Serialize| writes.
+  // NOTE: the calling context is responsible for deleting this pointer
+  void Serialize(void** buffer, int64_t* size) const;
+  bool Unserialize(const void* bytes, int64_t size);
+  int64_t SerializedSize() const;
+
+  // Returns the number of symbols counted by the histogram, before any
+  // scaling was applied.
+  uint64_t symbol_count() const {
+    return symbol_count_;
+  }
+
+  // Returns the normalized count of |symbol|: the number of the
+  // |kTableSize| states which decode to it.
+  int normalized_count(uint8_t symbol) const {
+    return static_cast<int>(norm_[symbol]);
+  }
+
+ private:
+  // The entry for each state of the decoder: the symbol it decodes to,
+  // and the base of the next state, to which |num_bits| bits are added.
+  struct DecodeEntry {
+    uint16_t base;
+    uint8_t symbol;
+    uint8_t num_bits;
+  };
+
+  // The transform for each symbol in the encoder. The number of bits
+  // written for a state |x| is |(x + delta_bits) >> 16|, and the next state
+  // is found at |(x >> num_bits) + delta_state| in |state_table_|.
+  struct SymbolTransform {
+    uint32_t delta_bits;
+    int32_t delta_state;
+  };
+
+  // Normalizes |histogram_| into |norm_|, and then fills the encode and
+  // decode tables.
+  void BuildTable();
+
+  // Scales the counts of |histogram_| so that they sum to |kTableSize|.
+  // Every symbol which occurs receives at least one state. Rounding errors
+  // are corrected one state at a time, each time adjusting the symbol for
+  // which the change costs the fewest bits.
+  void Normalize();
+
+  // The (possibly scaled) histogram from which the table is built, and
+  // the true number of symbols it describes.
+  std::vector<uint32_t> histogram_ = {};
+  uint64_t symbol_count_ = 0;
+
+  std::vector<uint32_t> norm_ = {};
+  std::vector<SymbolTransform> transforms_ = {};
+  std::vector<uint16_t> state_table_ = {};
+  std::vector<DecodeEntry> decode_table_ = {};
+};  // class Ans
+}  // namespace ans
+}  // namespace compression
+
+#endif  // HUFFMAN_COMPRESSION_ANS_ANS_H_
@@ -0,0 +1,217 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// Unit test for Ans class
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "compression/ans/ans.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+using compression::ans::Ans;
+
+namespace {
+// Returns the number of bytes needed to code |data| at its order-zero
+// entropy.
+double EntropyBytes(const vector<uint8_t>& data) {
+  vector<uint64_t> counts(256, 0);
+  for (uint8_t c : data) {
+    ++counts[c];
+  }
+  double bits = 0;
+  for (uint64_t count : counts) {
+    if (count > 0) {
+      bits -= count * std::log2(static_cast<double>(count) / data.size());
+    }
+  }
+  return bits / 8;
+}
+
+// Codes |data|, then decodes it with a second object built from the
+// serialized histogram. Returns true if and only if the data survived the
+// round trip and was coded within |slack| of its entropy.
+bool RoundTrip(const string& name, const vector<uint8_t>& data,
+               double slack) {
+  int64_t data_size = static_cast<int64_t>(data.size());
+  Ans ans;
+  ans.BuildTable(data.data(), data_size);
+
+  void* coded = nullptr;
+  int64_t coded_size = -1;
+  ans.Encode(data.data(), data_size, &coded, &coded_size);
+
+  void* header = nullptr;
+  int64_t header_size = -1;
+  ans.Serialize(&header, &header_size);
+
+  Ans other;
+  void* decoded = nullptr;
+  int64_t size = -1;
+  bool sane = other.Unserialize(header, header_size) &&
+      other.Decode(coded, coded_size, &decoded, &size, data_size);
+  bool fidelity = sane && size == data_size &&
+      (size == 0 || memcmp(decoded, data.data(), data.size()) == 0);
+
+  double entropy = EntropyBytes(data);
+  bool efficient = coded_size <= entropy * (1 + slack) + 8;
+
+  cout << name << ": " << data.size() << " -> " << coded_size
+       << " bytes (entropy " << static_cast<int64_t>(entropy) << ")"
+       << "\n  Fidelity: " << fidelity
+       << "\n  Efficient: " << efficient << endl;
+
+  delete[] reinterpret_cast<uint8_t*>(coded);
+  delete[] reinterpret_cast<uint8_t*>(header);
+  delete[] reinterpret_cast<uint8_t*>(decoded);
+  return fidelity && efficient;
+}
+
+// Returns true if decoding |coded| into at most |max_size| bytes fails.
+bool Rejects(const Ans& ans, const vector<uint8_t>& coded,
+             int64_t max_size) {
+  void* decoded = nullptr;
+  int64_t size = -1;
+  bool sane = ans.Decode(coded.data(), static_cast<int64_t>(coded.size()),
+                         &decoded, &size, max_size);
+  delete[] reinterpret_cast<uint8_t*>(decoded);
+  return !sane;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool ok = true;
+  srand(1);
+
+  ok &= RoundTrip("Empty", {}, 0);
+  ok &= RoundTrip("Constant", vector<uint8_t>(1000, 'a'), 0);
+
+  // Every length up to a few words, to exercise the ends of both loops.
+  bool lengths = true;
+  for (int length = 1; length < 40; ++length) {
+    vector<uint8_t> data(static_cast<size_t>(length));
+    for (auto& c : data) {
+      c = 'a' + rand() % 3;
+    }
+    Ans ans;
+    ans.BuildTable(data.data(), length);
+    void* coded = nullptr;
+    int64_t coded_size = -1;
+    ans.Encode(data.data(), length, &coded, &coded_size);
+    void* decoded = nullptr;
+    int64_t size = -1;
+    lengths &= ans.Decode(coded, coded_size, &decoded, &size, length) &&
+        size == length && memcmp(decoded, data.data(), data.size()) == 0;
+    delete[] reinterpret_cast<uint8_t*>(coded);
+    delete[] reinterpret_cast<uint8_t*>(decoded);
+  }
+  cout << "Short lengths: " << lengths << endl;
+  ok &= lengths;
+
+  // A Huffman code cannot spend less than one bit on the common symbol.
+  vector<uint8_t> skewed(100000, 'x');
+  for (size_t i = 0; i < skewed.size(); i += 20) {
+    skewed[i] = 'a' + (i / 20) % 16;
+  }
+  ok &= RoundTrip("Skewed", skewed, 0.02);
+
+  vector<uint8_t> biased(100001);
+  for (auto& c : biased) {
+    c = (rand() % 100 < 95) ? '0' : '1';
+  }
+  ok &= RoundTrip("Biased coin", biased, 0.02);
+
+  vector<uint8_t> text;
+  string words[] = {"the ", "quick ", "brown ", "fox ", "jumps ", "over ",
+                    "lazy ", "dog ", "\n"};
+  while (text.size() < 300000) {
+    const string& word = words[rand() % 9];
+    text.insert(text.end(), word.begin(), word.end());
+  }
+  ok &= RoundTrip("Text", text, 0.01);
+
+  // Every byte value, most of them rare.
+  vector<uint8_t> wide(50000);
+  for (size_t i = 0; i < wide.size(); ++i) {
+    wide[i] = (i < 256) ? static_cast<uint8_t>(i) :
+        (rand() % 4 == 0) ? rand() : 'e';
+  }
+  ok &= RoundTrip("All symbols", wide, 0.02);
+
+  vector<uint8_t> random(100000);
+  for (auto& c : random) {
+    c = rand();
+  }
+  ok &= RoundTrip("Random", random, 0.01);
+
+  cout << "==========TESTING NORMALIZATION==========" << endl;
+  Ans ans;
+  ans.BuildTable(wide.data(), static_cast<int64_t>(wide.size()));
+  int total = 0;
+  bool present = true;
+  for (int i = 0; i < 256; ++i) {
+    total += ans.normalized_count(i);
+    present &= ans.normalized_count(i) > 0;
+  }
+  bool normalized = total == Ans::kTableSize && present;
+  cout << "Normalized counts sum to table: " << normalized << endl;
+  ok &= normalized;
+
+  // The estimate is close to the bits actually written.
+  vector<uint64_t> histogram(256, 0);
+  for (uint8_t c : text) {
+    ++histogram[c];
+  }
+  ans.BuildTable(histogram);
+  void* coded = nullptr;
+  int64_t coded_size = -1;
+  ans.Encode(text.data(), static_cast<int64_t>(text.size()), &coded,
+             &coded_size);
+  double estimate = ans.CodedBits(histogram) / 8.0;
+  bool estimated = std::fabs(estimate - coded_size) < 0.01 * coded_size;
+  cout << "Estimate " << static_cast<int64_t>(estimate) << " for "
+       << coded_size << " bytes: " << estimated << endl;
+  ok &= estimated;
+
+  histogram['Z'] = 1;
+  bool missing = ans.CodedBits(histogram) == UINT64_MAX;
+  cout << "Missing symbol reported: " << missing << endl;
+  ok &= missing;
+
+  cout << "==========TESTING DAMAGE==========" << endl;
+  const uint8_t* coded_bytes = reinterpret_cast<const uint8_t*>(coded);
+  vector<uint8_t> stream(coded_bytes, coded_bytes + coded_size);
+  delete[] reinterpret_cast<uint8_t*>(coded);
+
+  int64_t max_size = static_cast<int64_t>(text.size());
+  bool rejected = Rejects(ans, vector<uint8_t>(stream.begin(),
+                                               stream.end() - 1), max_size);
+  rejected &= Rejects(ans, vector<uint8_t>(stream.begin() + 1,
+                                           stream.end()), max_size);
+  vector<uint8_t> no_marker = stream;
+  no_marker.back() = 0;
+  rejected &= Rejects(ans, no_marker, max_size);
+  rejected &= Rejects(ans, {}, max_size);
+  cout << "Damaged streams rejected: " << rejected << endl;
+  ok &= rejected;
+
+  // The count is checked before the output is allocated, however it might
+  // otherwise be decoded.
+  rejected = Rejects(ans, stream, max_size - 1) && !Rejects(ans, stream,
+                                                            max_size);
+  cout << "Oversized output rejected: " << rejected << endl;
+  ok &= rejected;
+
+  cout << "All passed: " << ok << endl;
+  return ok ? 0 : 1;
+}
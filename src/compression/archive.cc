@@ -0,0 +1,177 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+
+#include "compression/archive.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <istream>
+#include <iterator>
+#include <vector>
+
+#include "base/crc32c.h"
+#include "base/stats.h"
+#include "compression/block.h"
+
+using std::ios;
+using std::vector;
+
+namespace compression {
+FrameReader::FrameReader(std::istream* archive, bool recover,
+                         int64_t max_block_size)
+    : archive_(archive), recover_(recover), max_block_size_(max_block_size) {
+  archive_->seekg(0, ios::end);
+  size_ = archive_->tellg();
+  synced_ = AtSyncMarker(0);
+}
+
+bool FrameReader::Read(Frame* frame) {
+  frame->error = nullptr;
+  frame->damaged_end = 0;
+  frame->offset = position_;
+  if (position_ == size_) {
+    return false;
+  }
+
+  int64_t frame_end = 0;
+  const char* problem = ReadFrame(frame, &frame_end);
+  // The archive cannot be recovered from an error in reading it.
+  if (archive_->bad()) {
+    error_ = "Failed to read archive";
+    return false;
+  }
+  if (problem == nullptr) {
+    position_ = frame_end;
+    return true;
+  }
+  if (!recover_ || !synced_) {
+    error_ = problem;
+    return false;
+  }
+
+  frame->error = problem;
+  frame->damaged_end = FindSyncMarker(position_ + 1);
+  damaged_size_ += frame->damaged_end - position_;
+  position_ = frame->damaged_end;
+  return true;
+}
+
+const char* FrameReader::ReadFrame(Frame* frame, int64_t* frame_end) {
+  int64_t position = position_;
+  if (synced_) {
+    if (!AtSyncMarker(position)) {
+      return "Missing sync marker";
+    }
+    position += static_cast<int64_t>(sizeof(kSyncMarker));
+  }
+
+  uint64_t frame_size;
+  if (size_ - position < static_cast<int64_t>(sizeof(frame_size))) {
+    return "Truncated frame header";
+  }
+  archive_->seekg(position);
+  archive_->read(reinterpret_cast<char*>(&frame_size), sizeof(frame_size));
+  position += static_cast<int64_t>(sizeof(frame_size));
+  frame->checksummed = (frame_size & kChecksummedFrame) != 0;
+  frame_size &= ~kChecksummedFrame;
+  int trailer_size = frame->checksummed ? kChecksumsSize : 0;
+
+  // A corrupt size must not be allowed to exhaust memory, so the block is
+  // only read if it is no larger than the largest block can be stored, and
+  // the archive is long enough to contain it.
+  if (frame_size > static_cast<uint64_t>(max_block_size_ + kBlockHeaderSize)) {
+    return "Frame too large";
+  }
+  int64_t block_size = static_cast<int64_t>(frame_size);
+  if (block_size + trailer_size > size_ - position) {
+    return "Truncated block";
+  }
+
+  frame->input.resize(frame_size);
+  frame->input_size = block_size;
+  archive_->read(frame->input.data(), block_size);
+  if (frame->checksummed) {
+    archive_->read(reinterpret_cast<char*>(&frame->block_crc),
+                   sizeof(frame->block_crc));
+    archive_->read(reinterpret_cast<char*>(&frame->data_crc),
+                   sizeof(frame->data_crc));
+  }
+  position += block_size + trailer_size;
+
+  // A corrupt size which happens to fit in the archive is caught here,
+  // before the frames it swallowed are lost.
+  if (synced_ && position != size_ && !AtSyncMarker(position)) {
+    return "Frame does not end at a sync marker";
+  }
+
+  header_size_ += static_cast<int64_t>(
+      (synced_ ? sizeof(kSyncMarker) : 0) + sizeof(frame_size)) +
+      kBlockHeaderSize + trailer_size;
+  data_size_ += block_size - kBlockHeaderSize;
+  *frame_end = position;
+  return nullptr;
+}
+
+bool FrameReader::AtSyncMarker(int64_t position) {
+  char marker[sizeof(kSyncMarker)];
+  int64_t length =
+      std::min(static_cast<int64_t>(sizeof(marker)), size_ - position);
+  if (length <= 0) {
+    return false;
+  }
+  archive_->seekg(position);
+  archive_->read(marker, length);
+  return memcmp(marker, kSyncMarker, static_cast<size_t>(length)) == 0;
+}
+
+int64_t FrameReader::FindSyncMarker(int64_t position) {
+  static constexpr int64_t kWindow = 1 << 16;
+  static constexpr int64_t kOverlap = sizeof(kSyncMarker) - 1;
+
+  vector<char> window(kWindow + kOverlap);
+  for (; position < size_; position += kWindow) {
+    int64_t length = std::min(kWindow + kOverlap, size_ - position);
+    archive_->seekg(position);
+    archive_->read(window.data(), length);
+    auto found = std::search(window.begin(), window.begin() + length,
+                             std::begin(kSyncMarker),
+                             std::end(kSyncMarker));
+    if (found != window.begin() + length) {
+      return position + (found - window.begin());
+    }
+  }
+  return size_;
+}
+
+const char* DecodeFrame(const Frame& frame, void** data, int64_t* size,
+                        int64_t max_size) {
+  *data = nullptr;
+  if (frame.checksummed) {
+    STATS_TIMER(kChecksumStage);
+    if (base::Crc32c(frame.input.data(), frame.input_size) !=
+        frame.block_crc) {
+      return "Checksum mismatch in block";
+    }
+  }
+
+  // As when the archive is written, the checksums are passes of their own
+  // over blocks which are still in cache; they cost about 6% of the time
+  // taken to decode.
+  if (!DecodeBlock(frame.input.data(), frame.input_size, data, size,
+                   max_size)) {
+    return "Failed to decode block";
+  }
+
+  if (frame.checksummed) {
+    STATS_TIMER(kChecksumStage);
+    if (base::Crc32c(*data, *size) != frame.data_crc) {
+      delete[] reinterpret_cast<uint8_t*>(*data);
+      *data = nullptr;
+      return "Checksum mismatch in decoded block";
+    }
+  }
+  return nullptr;
+}
+}  // namespace compression
@@ -0,0 +1,115 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// An archive is a sequence of frames, each of which is a 64-bit integer
+// giving the size of the block which follows it. Blocks are described in
+// "compression/block.h".
+//
+// If the high bit of the size is set, the block is followed by two CRC-32C
+// checksums: first that of the block, and then that of the uncompressed
+// data. The first is verified before the block is decoded, so that corrupt
+// data is never given to the decoder, and the second verifies the decoder.
+//
+// If the archive was created with |--sync|, every frame is preceded by the
+// eight bytes of |kSyncMarker|. When a frame is damaged, a reader which
+// recovers scans ahead for the next marker and resumes there, so that only
+// the damaged frames are lost. A damaged block can only be detected if it
+// fails to decode, or if it is checksummed, so |--sync| is best used
+// together with |--checksum|.
+
+#ifndef HUFFMAN_COMPRESSION_ARCHIVE_H_
+#define HUFFMAN_COMPRESSION_ARCHIVE_H_
+
+#include <cstdint>
+
+#include <istream>
+#include <vector>
+
+#include "compression/block.h"
+
+namespace compression {
+// Marks a frame which is followed by its checksums.
+static constexpr uint64_t kChecksummedFrame = uint64_t{1} << 63;
+
+// The length of the checksums which follow a checksummed frame.
+static constexpr int kChecksumsSize = 2 * sizeof(uint32_t);
+
+// The marker which begins every frame of an archive created with |--sync|.
+// Read as a frame size, it is larger than any archive, so an archive
+// without markers is never mistaken for one with them.
+static constexpr char kSyncMarker[] = {
+  '\xFF', '\xD3', 'H', 'U', 'F', 'S', 'Y', 'N',
+};
+
+// A frame as read from an archive. |input| is reused from one frame to the
+// next.
+struct Frame {
+  std::vector<char> input = {};
+  int64_t input_size = 0;
+  int64_t offset = 0;       // The position of the frame in the archive
+
+  bool checksummed = false;
+  uint32_t block_crc = 0;   // The checksum of the block
+  uint32_t data_crc = 0;    // The checksum of the uncompressed data
+  const char* error = nullptr;
+  int64_t damaged_end = 0;  // The end of a damaged region which was skipped
+};
+
+// Reads the frames of an archive one at a time. If the archive has sync
+// markers and |recover| is given, damage to the framing is skipped by
+// resuming at the next marker. A frame too large to hold a block of
+// |max_block_size| bytes is damaged, and is never read into memory.
+class FrameReader {
+ public:
+  FrameReader(std::istream* archive, bool recover,
+              int64_t max_block_size = kMaxBlockSize);
+
+  // Reads the next frame into |frame|. A damaged region which was skipped
+  // is returned as a frame with an |error| and a nonzero |damaged_end|.
+  //
+  // Returns false at the end of the archive, or if the archive is damaged
+  // and cannot be recovered or cannot be read, in which case |error| is set.
+  bool Read(Frame* frame);
+
+  int64_t header_size() const { return header_size_; }
+  int64_t data_size() const { return data_size_; }
+  int64_t damaged_size() const { return damaged_size_; }
+  int64_t position() const { return position_; }
+  const char* error() const { return error_; }
+
+ private:
+  // Reads the frame at |position_|, setting |*frame_end| to the position
+  // following it. Returns a description of the problem if it is damaged,
+  // or null otherwise.
+  const char* ReadFrame(Frame* frame, int64_t* frame_end);
+
+  // Returns true if a sync marker begins at |position|, even if the end of
+  // the archive cuts it short, so that the frame before it is not lost too.
+  bool AtSyncMarker(int64_t position);
+
+  // Returns the position of the first sync marker at or after |position|,
+  // or the end of the archive if there is none.
+  int64_t FindSyncMarker(int64_t position);
+
+  std::istream* archive_;
+  bool recover_;
+  int64_t max_block_size_;
+  int64_t size_ = 0;
+  bool synced_ = false;
+
+  int64_t position_ = 0;
+  int64_t header_size_ = 0;
+  int64_t data_size_ = 0;
+  int64_t damaged_size_ = 0;
+  const char* error_ = nullptr;
+};
+
+// Verifies and decodes |frame| into a newly allocated buffer of at most
+// |max_size| bytes, as |DecodeBlock| does. Returns a description of the
+// problem if it is corrupt, or null otherwise.
+// NOTE: the calling context is responsible for deleting this pointer
+const char* DecodeFrame(const Frame& frame, void** data, int64_t* size,
+                        int64_t max_size = kMaxBlockSize);
+}  // namespace compression
+
+#endif  // HUFFMAN_COMPRESSION_ARCHIVE_H_
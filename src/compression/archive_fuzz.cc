@@ -0,0 +1,148 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// Fuzz target for reading archives with |FrameReader| and |DecodeFrame|.
+// See "base/fuzz.h".
+//
+// The first byte of the input chooses options:
+//
+//   bit 0: read with |recover|
+//   bit 1: build the archive, rather than reading the rest of the input
+//   bit 2: when building, checksum each frame
+//   bit 3: when building, begin each frame with a sync marker
+//   bits 4-7: when building, the number of bytes to damage
+//
+// When the archive is built, the rest of the input is its text, which is
+// split into blocks of a size given by its first byte. The damage is placed
+// by the bytes of the text too. An undamaged archive must give back its
+// text exactly; any other must be read to its end, or to an error, without
+// reading out of bounds or looping. Frames and blocks are read with limits
+// of |base::kMaxFuzzOutput|, which the built archives are within.
+
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/crc32c.h"
+#include "base/fuzz.h"
+#include "compression/archive.h"
+#include "compression/block.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+// Writes |text| as an archive, as the |--c| command of the huffman binary
+// does.
+string BuildArchive(const uint8_t* text, size_t size, size_t block_size,
+                    bool checksum, bool sync) {
+  string archive;
+  for (size_t offset = 0; offset < size; offset += block_size) {
+    size_t length = std::min(block_size, size - offset);
+    void* block = nullptr;
+    int64_t block_size_out = -1;
+    compression::EncodeBlock(text + offset, static_cast<int64_t>(length),
+                             &block, &block_size_out);
+
+    if (sync) {
+      archive.append(compression::kSyncMarker,
+                     sizeof(compression::kSyncMarker));
+    }
+    uint64_t frame_size = static_cast<uint64_t>(block_size_out);
+    if (checksum) {
+      frame_size |= compression::kChecksummedFrame;
+    }
+    archive.append(reinterpret_cast<const char*>(&frame_size),
+                   sizeof(frame_size));
+    archive.append(reinterpret_cast<const char*>(block),
+                   static_cast<size_t>(block_size_out));
+    if (checksum) {
+      uint32_t block_crc = base::Crc32c(block, block_size_out);
+      uint32_t data_crc = base::Crc32c(text + offset,
+                                       static_cast<int64_t>(length));
+      archive.append(reinterpret_cast<const char*>(&block_crc),
+                     sizeof(block_crc));
+      archive.append(reinterpret_cast<const char*>(&data_crc),
+                     sizeof(data_crc));
+    }
+    delete[] reinterpret_cast<uint8_t*>(block);
+  }
+  return archive;
+}
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  base::FuzzInput input(data, size);
+  uint8_t options = input.Byte();
+  bool recover = (options & 1) != 0;
+  bool build = (options & 2) != 0;
+  size_t rest_size;
+  const uint8_t* rest = input.Rest(&rest_size);
+
+  string archive;
+  int num_damages = 0;
+  if (build) {
+    base::FuzzInput choices(rest, rest_size);
+    size_t block_size = 1 + choices.Byte();
+    archive = BuildArchive(rest, rest_size, block_size, (options & 4) != 0,
+                           (options & 8) != 0);
+    num_damages = options >> 4;
+    for (int i = 0; i < num_damages && !archive.empty(); ++i) {
+      archive[choices.Below(archive.size())] ^= 1 << (choices.Byte() % 8);
+    }
+  } else {
+    archive.assign(reinterpret_cast<const char*>(rest), rest_size);
+  }
+
+  std::istringstream stream(archive);
+  compression::FrameReader reader(&stream, recover, base::kMaxFuzzOutput);
+  compression::Frame frame;
+  string extracted;
+  bool damaged = false;
+  int64_t position = 0;
+  while (reader.Read(&frame)) {
+    FUZZ_CHECK(frame.offset == position);
+    FUZZ_CHECK(reader.position() > position);
+    FUZZ_CHECK(reader.position() <= static_cast<int64_t>(archive.size()));
+    position = reader.position();
+    if (frame.error != nullptr) {
+      FUZZ_CHECK(frame.damaged_end == position);
+      damaged = true;
+      continue;
+    }
+
+    FUZZ_CHECK(frame.input_size <=
+               base::kMaxFuzzOutput + compression::kBlockHeaderSize);
+
+    uint64_t raw_size = 0;
+    if (frame.input_size >= compression::kBlockHeaderSize) {
+      memcpy(&raw_size, frame.input.data() + 1, sizeof(raw_size));
+    }
+    void* decoded = nullptr;
+    int64_t decoded_size = -1;
+    if (compression::DecodeFrame(frame, &decoded, &decoded_size,
+                                 base::kMaxFuzzOutput) != nullptr) {
+      FUZZ_CHECK(decoded == nullptr);
+      damaged = true;
+      continue;
+    }
+    FUZZ_CHECK(static_cast<uint64_t>(decoded_size) == raw_size);
+    extracted.append(reinterpret_cast<const char*>(decoded),
+                     static_cast<size_t>(decoded_size));
+    delete[] reinterpret_cast<uint8_t*>(decoded);
+  }
+  damaged |= reader.error() != nullptr;
+  FUZZ_CHECK(reader.error() != nullptr ||
+             position == static_cast<int64_t>(archive.size()));
+
+  if (build && num_damages == 0) {
+    FUZZ_CHECK(!damaged);
+    FUZZ_CHECK(extracted ==
+               string(reinterpret_cast<const char*>(rest), rest_size));
+  }
+  return 0;
+}
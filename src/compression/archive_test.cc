@@ -0,0 +1,229 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// Unit test for reading archives, and recovering from damage to them
+// Assumes block encoding is sane
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/crc32c.h"
+#include "compression/archive.h"
+#include "compression/block.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+using compression::DecodeFrame;
+using compression::Frame;
+using compression::FrameReader;
+
+namespace {
+// Writes |text| as an archive of |block_size| byte blocks, as the |--c|
+// command of the huffman binary does. The position of each frame is
+// appended to |offsets|.
+string BuildArchive(const string& text, size_t block_size, bool checksum,
+                    bool sync, vector<size_t>* offsets) {
+  string archive;
+  for (size_t offset = 0; offset < text.size(); offset += block_size) {
+    size_t length = std::min(block_size, text.size() - offset);
+    void* block = nullptr;
+    int64_t block_size_out = -1;
+    compression::EncodeBlock(text.data() + offset,
+                             static_cast<int64_t>(length), &block,
+                             &block_size_out);
+
+    offsets->push_back(archive.size());
+    if (sync) {
+      archive.append(compression::kSyncMarker,
+                     sizeof(compression::kSyncMarker));
+    }
+    uint64_t frame_size = static_cast<uint64_t>(block_size_out);
+    if (checksum) {
+      frame_size |= compression::kChecksummedFrame;
+    }
+    archive.append(reinterpret_cast<const char*>(&frame_size),
+                   sizeof(frame_size));
+    archive.append(reinterpret_cast<const char*>(block),
+                   static_cast<size_t>(block_size_out));
+    if (checksum) {
+      uint32_t block_crc = base::Crc32c(block, block_size_out);
+      uint32_t data_crc = base::Crc32c(text.data() + offset,
+                                       static_cast<int64_t>(length));
+      archive.append(reinterpret_cast<const char*>(&block_crc),
+                     sizeof(block_crc));
+      archive.append(reinterpret_cast<const char*>(&data_crc),
+                     sizeof(data_crc));
+    }
+    delete[] reinterpret_cast<uint8_t*>(block);
+  }
+  return archive;
+}
+
+// The outcome of reading an archive to its end.
+struct Extraction {
+  string text;
+  int damaged_frames = 0;
+  const char* error = nullptr;
+  bool read_to_end = false;
+};
+
+// Reads and decodes every frame of |archive|, as the |--x| command of the
+// huffman binary does with |--skip_corrupt|.
+Extraction Extract(const string& archive, bool recover,
+                   int64_t max_block_size = compression::kMaxBlockSize) {
+  std::istringstream stream(archive);
+  FrameReader reader(&stream, recover, max_block_size);
+  Frame frame;
+  Extraction extraction;
+  while (reader.Read(&frame)) {
+    if (frame.error != nullptr) {
+      ++extraction.damaged_frames;
+      continue;
+    }
+    void* decoded = nullptr;
+    int64_t decoded_size = -1;
+    if (DecodeFrame(frame, &decoded, &decoded_size) != nullptr) {
+      ++extraction.damaged_frames;
+      continue;
+    }
+    extraction.text.append(reinterpret_cast<const char*>(decoded),
+                           static_cast<size_t>(decoded_size));
+    delete[] reinterpret_cast<uint8_t*>(decoded);
+  }
+  extraction.error = reader.error();
+  extraction.read_to_end =
+      reader.position() == static_cast<int64_t>(archive.size());
+  return extraction;
+}
+
+bool Report(const string& name, bool passed) {
+  cout << name << ": " << passed << endl;
+  return passed;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool ok = true;
+  srand(1);
+
+  string text;
+  string words[] = {"the ", "quick ", "brown ", "fox ", "jumps ", "over ",
+                    "lazy ", "dog ", "\n"};
+  while (text.size() < 40000) {
+    text += words[rand() % 9];
+  }
+  text.resize(40000);
+  const size_t kBlockSize = 10000;
+
+  for (int options = 0; options < 4; ++options) {
+    bool checksum = (options & 1) != 0;
+    bool sync = (options & 2) != 0;
+    vector<size_t> offsets;
+    string archive = BuildArchive(text, kBlockSize, checksum, sync, &offsets);
+    Extraction extraction = Extract(archive, sync);
+    ok &= Report(string("Round trip") + (checksum ? ", checksummed" : "") +
+                 (sync ? ", synced" : ""),
+                 extraction.text == text && extraction.damaged_frames == 0 &&
+                 extraction.error == nullptr && extraction.read_to_end);
+  }
+
+  // Damage to the size of the second frame loses that frame alone.
+  vector<size_t> offsets;
+  string archive = BuildArchive(text, kBlockSize, true, true, &offsets);
+  string damaged = archive;
+  damaged[offsets[1] + sizeof(compression::kSyncMarker) + 2] ^= 0x40;
+  Extraction extraction = Extract(damaged, true);
+  ok &= Report("Corrupt frame size recovered",
+               extraction.damaged_frames == 1 &&
+               extraction.text == text.substr(0, kBlockSize) +
+                                  text.substr(2 * kBlockSize) &&
+               extraction.error == nullptr && extraction.read_to_end);
+
+  extraction = Extract(damaged, false);
+  ok &= Report("Corrupt frame size fatal without recover",
+               extraction.text == text.substr(0, kBlockSize) &&
+               extraction.error != nullptr);
+
+  // Noise is stored as it is, so a marker in it appears in the archive.
+  // It must be ignored when the frames are sound, and when resuming after
+  // damage it is only a false start.
+  string noisy = text.substr(0, kBlockSize);
+  string noise(kBlockSize, '\0');
+  for (auto& c : noise) {
+    c = rand();
+  }
+  std::copy(std::begin(compression::kSyncMarker),
+            std::end(compression::kSyncMarker), noise.begin() + 100);
+  noisy += noise + text.substr(0, kBlockSize);
+  offsets.clear();
+  archive = BuildArchive(noisy, kBlockSize, true, true, &offsets);
+  string marker(compression::kSyncMarker, sizeof(compression::kSyncMarker));
+  bool stored = archive.find(marker, offsets[1] + 1) < offsets[2];
+  extraction = Extract(archive, true);
+  ok &= Report("Marker in block data ignored",
+               stored && extraction.text == noisy &&
+               extraction.damaged_frames == 0 && extraction.read_to_end);
+
+  damaged = archive;
+  damaged[offsets[1] + sizeof(compression::kSyncMarker) + 2] ^= 0x40;
+  extraction = Extract(damaged, true);
+  ok &= Report("Marker in block data skipped in recovery",
+               extraction.text == noisy.substr(0, kBlockSize) +
+                                  noisy.substr(2 * kBlockSize) &&
+               extraction.error == nullptr && extraction.read_to_end);
+
+  // An archive cut off within the marker of its last frame.
+  offsets.clear();
+  archive = BuildArchive(text, kBlockSize, true, true, &offsets);
+  string truncated = archive.substr(0, offsets.back() + 4);
+  extraction = Extract(truncated, true);
+  ok &= Report("Truncated marker recovered",
+               extraction.text == text.substr(0, 3 * kBlockSize) &&
+               extraction.damaged_frames == 1 &&
+               extraction.error == nullptr && extraction.read_to_end);
+
+  extraction = Extract(truncated, false);
+  ok &= Report("Truncated marker fatal without recover",
+               extraction.text == text.substr(0, 3 * kBlockSize) &&
+               extraction.error != nullptr);
+
+  // Frames too large for the limit are damaged, and are not read. Noise is
+  // stored, so its frame is larger than its block; this time it has no
+  // marker, so that recovery resumes at the next frame.
+  noise[100] ^= 1;
+  noisy = text.substr(0, kBlockSize) + noise + text.substr(0, kBlockSize);
+  offsets.clear();
+  archive = BuildArchive(noisy, kBlockSize, true, true, &offsets);
+  extraction = Extract(archive, true, kBlockSize - 1);
+  ok &= Report("Oversized frame skipped",
+               extraction.damaged_frames == 1 &&
+               extraction.text == noisy.substr(0, kBlockSize) +
+                                  noisy.substr(2 * kBlockSize) &&
+               extraction.error == nullptr && extraction.read_to_end);
+
+  // Without markers there is nowhere to resume, so even with |recover| the
+  // first damage ends the archive.
+  offsets.clear();
+  archive = BuildArchive(text, kBlockSize, true, false, &offsets);
+  damaged = archive;
+  damaged[offsets[1] + 2] ^= 0x40;
+  extraction = Extract(damaged, true);
+  ok &= Report("Damage fatal without markers",
+               extraction.text == text.substr(0, kBlockSize) &&
+               extraction.damaged_frames == 0 &&
+               extraction.error != nullptr && !extraction.read_to_end);
+
+  cout << "All passed: " << ok << endl;
+  return ok ? 0 : 1;
+}
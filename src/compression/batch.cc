@@ -0,0 +1,320 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+
+#include "compression/batch.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#include <memory>
+#include <vector>
+
+#include "compression/huffman/huffman.h"
+
+#include "base/bitstring.h"
+
+using std::vector;
+
+using compression::huffman::Huffman;
+
+namespace compression {
+namespace {
+// The number of times messages are reassigned after a table is added.
+static constexpr int kClusterIterations = 3;
+
+// Marks a message which a table cannot code.
+static constexpr uint64_t kUncodable = UINT64_MAX;
+
+void PutVarint(uint64_t value, vector<uint8_t>* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<uint8_t>(value));
+}
+
+bool GetVarint(const uint8_t** ptr, const uint8_t* end, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (*ptr == end) {
+      return false;
+    }
+    uint8_t byte = *(*ptr)++;
+    *value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns the number of bits |huf| needs for |message|, or |kUncodable|.
+uint64_t CostOf(const Huffman& huf, const Span& message) {
+  const uint8_t* values_ptr = reinterpret_cast<const uint8_t*>(message.data);
+
+  uint64_t num_bits = 0;
+  for (int64_t i = 0; i < message.size; ++i) {
+    int length = huf.code_length(values_ptr[i]);
+    if (length == 0) {
+      return kUncodable;
+    }
+    num_bits += static_cast<uint64_t>(length);
+  }
+  return num_bits;
+}
+
+int64_t BytesOf(uint64_t num_bits) {
+  return static_cast<int64_t>((num_bits + base::kByteBits - 1) /
+                              base::kByteBits);
+}
+}  // namespace
+
+void BatchEncoder::Assign(const vector<Span>& messages) {
+  for (size_t i = 0; i < messages.size(); ++i) {
+    uint64_t best = kUncodable;
+    for (size_t t = 0; t < tables_.size(); ++t) {
+      uint64_t cost = CostOf(*tables_[t], messages[i]);
+      if (cost < best) {
+        best = cost;
+        assignment_[i] = t;
+      }
+    }
+    // A message is always codable by the table which was built from it.
+    assert(best != kUncodable);
+    bits_[i] = best;
+  }
+}
+
+void BatchEncoder::Rebuild(const vector<Span>& messages) {
+  vector<vector<uint64_t>> histograms(
+      tables_.size(), vector<uint64_t>(base::kMaxByte, 0));
+  vector<int64_t> totals(tables_.size(), 0);
+  for (size_t i = 0; i < messages.size(); ++i) {
+    const uint8_t* values_ptr =
+        reinterpret_cast<const uint8_t*>(messages[i].data);
+    vector<uint64_t>& histogram = histograms[assignment_[i]];
+    for (int64_t j = 0; j < messages[i].size; ++j) {
+      ++histogram[values_ptr[j]];
+    }
+    totals[assignment_[i]] += messages[i].size;
+  }
+
+  // Tables without any data are dropped, and the others renumbered.
+  vector<size_t> renumber(tables_.size(), 0);
+  size_t kept = 0;
+  for (size_t t = 0; t < tables_.size(); ++t) {
+    if (totals[t] == 0) continue;
+    renumber[t] = kept;
+    tables_[t]->BuildTree(histograms[t]);
+    std::swap(tables_[kept++], tables_[t]);
+  }
+  tables_.resize(kept);
+  for (size_t i = 0; i < messages.size(); ++i) {
+    assignment_[i] = renumber[assignment_[i]];
+  }
+}
+
+void BatchEncoder::Encode(const vector<Span>& messages,
+                          void** buffer, int64_t* buffer_size) {
+  assert(max_tables_ >= 1 && max_tables_ <= kMaxBatchTables);
+
+  assignment_.assign(messages.size(), 0);
+  bits_.assign(messages.size(), 0);
+
+  // Begin with a single table shared by every message.
+  if (tables_.empty()) {
+    tables_.emplace_back(new Huffman());
+  }
+  tables_.resize(1);
+  Rebuild(messages);
+  if (!tables_.empty()) {
+    Assign(messages);
+  }
+
+  // Each additional table is seeded from the message which is coded least
+  // efficiently, and then the assignment is refined. A table is only kept
+  // if it saves more than it costs to store.
+  auto total_size = [this]() {
+    int64_t total = 0;
+    for (auto it = bits_.cbegin(); it != bits_.cend(); ++it) {
+      total += BytesOf(*it);
+    }
+    for (auto it = tables_.cbegin(); it != tables_.cend(); ++it) {
+      total += (*it)->SerializedSize();
+    }
+    return total;
+  };
+
+  int64_t best_total = total_size();
+  while (!tables_.empty() &&
+         static_cast<int>(tables_.size()) < max_tables_) {
+    size_t worst = 0;
+    double worst_ratio = 0;
+    for (size_t i = 0; i < messages.size(); ++i) {
+      if (messages[i].size == 0) continue;
+      double ratio = static_cast<double>(bits_[i]) / messages[i].size;
+      if (ratio > worst_ratio) {
+        worst_ratio = ratio;
+        worst = i;
+      }
+    }
+
+    vector<size_t> previous = assignment_;
+    size_t previous_tables = tables_.size();
+    tables_.emplace_back(new Huffman());
+    tables_.back()->BuildTree(messages[worst].data, messages[worst].size);
+    for (int i = 0; i < kClusterIterations; ++i) {
+      Assign(messages);
+      Rebuild(messages);
+    }
+    Assign(messages);
+
+    int64_t total = total_size();
+    if (total >= best_total) {
+      // Restore the previous clustering, and stop.
+      assignment_ = previous;
+      while (tables_.size() < previous_tables) {
+        tables_.emplace_back(new Huffman());
+      }
+      tables_.resize(previous_tables);
+      Rebuild(messages);
+      Assign(messages);
+      break;
+    }
+    best_total = total;
+  }
+
+  // Build the tables and the message index, so that the buffer can be
+  // allocated once and each message coded directly into it.
+  vector<uint8_t> index;
+  index.push_back(tables_.size());
+  vector<void*> headers(tables_.size(), nullptr);
+  vector<int64_t> header_sizes(tables_.size(), 0);
+  int64_t headers_size = 0;
+  for (size_t t = 0; t < tables_.size(); ++t) {
+    tables_[t]->Serialize(&headers[t], &header_sizes[t]);
+    headers_size += header_sizes[t];
+  }
+
+  vector<uint8_t> messages_index;
+  int64_t data_size = 0;
+  PutVarint(messages.size(), &messages_index);
+  for (size_t i = 0; i < messages.size(); ++i) {
+    if (tables_.size() > 1) {
+      PutVarint(assignment_[i], &messages_index);
+    }
+    PutVarint(static_cast<uint64_t>(messages[i].size), &messages_index);
+    PutVarint(bits_[i], &messages_index);
+    data_size += BytesOf(bits_[i]);
+  }
+
+  *buffer_size = static_cast<int64_t>(index.size() + messages_index.size()) +
+      headers_size + data_size;
+  uint8_t* working_buf = new uint8_t[*buffer_size];
+  *buffer = working_buf;
+
+  memcpy(working_buf, index.data(), index.size());
+  working_buf += index.size();
+  for (size_t t = 0; t < tables_.size(); ++t) {
+    memcpy(working_buf, headers[t], static_cast<size_t>(header_sizes[t]));
+    working_buf += header_sizes[t];
+    delete[] reinterpret_cast<uint8_t*>(headers[t]);
+  }
+  memcpy(working_buf, messages_index.data(), messages_index.size());
+  working_buf += messages_index.size();
+
+  // Tables which code many symbols in all are worth preparing to code
+  // them in pairs, even though each message is short.
+  vector<int64_t> table_symbols(tables_.size(), 0);
+  for (size_t i = 0; i < messages.size(); ++i) {
+    if (messages[i].size == 0) continue;
+    table_symbols[assignment_[i]] += messages[i].size;
+  }
+  for (size_t t = 0; t < tables_.size(); ++t) {
+    if (table_symbols[t] >= Huffman::kPairTableMinSymbols) {
+      tables_[t]->BuildMap();
+    }
+  }
+
+  for (size_t i = 0; i < messages.size(); ++i) {
+    if (messages[i].size == 0) continue;
+    tables_[assignment_[i]]->EncodeInto(messages[i].data, messages[i].size,
+                                        working_buf);
+    working_buf += BytesOf(bits_[i]);
+  }
+}
+
+bool BatchDecoder::Init(const void* buffer, int64_t size) {
+  tables_.clear();
+  messages_.clear();
+
+  const uint8_t* ptr = reinterpret_cast<const uint8_t*>(buffer);
+  const uint8_t* end = ptr + size;
+  if (size < 1) {
+    return false;
+  }
+
+  int num_tables = *ptr++;
+  for (int t = 0; t < num_tables; ++t) {
+    tables_.emplace_back(new Huffman());
+    if (ptr == end || !tables_.back()->Unserialize(ptr, end - ptr)) {
+      return false;
+    }
+    ptr += Huffman::get_header_size(ptr);
+  }
+
+  // Every message occupies at least two bytes of the index, so a count
+  // larger than that is corrupt and must not be used to allocate.
+  uint64_t num_messages;
+  if (!GetVarint(&ptr, end, &num_messages) ||
+      num_messages > static_cast<uint64_t>(end - ptr) / 2) {
+    return false;
+  }
+
+  messages_.resize(num_messages);
+  for (auto it = messages_.begin(); it != messages_.end(); ++it) {
+    uint64_t table = 0;
+    uint64_t message_size;
+    if ((num_tables > 1 && !GetVarint(&ptr, end, &table)) ||
+        !GetVarint(&ptr, end, &message_size) ||
+        !GetVarint(&ptr, end, &it->num_bits)) {
+      return false;
+    }
+    // Every code is at least one bit long, so a size larger than the bit
+    // count is corrupt and must not be used to allocate.
+    if (message_size > it->num_bits ||
+        (message_size > 0 && table >= static_cast<uint64_t>(num_tables))) {
+      return false;
+    }
+    it->table = table;
+    it->size = static_cast<int64_t>(message_size);
+  }
+
+  for (auto it = messages_.begin(); it != messages_.end(); ++it) {
+    uint64_t num_bytes = it->num_bits / base::kByteBits +
+        (it->num_bits % base::kByteBits != 0);
+    if (static_cast<uint64_t>(end - ptr) < num_bytes) {
+      return false;
+    }
+    it->bits = ptr;
+    ptr += BytesOf(it->num_bits);
+  }
+  return ptr == end;
+}
+
+bool BatchDecoder::Decode(int64_t index, void** data, int64_t* size) const {
+  const Message& message = messages_.at(static_cast<size_t>(index));
+
+  // |Init| has checked the size against the coded bits, so the message is
+  // decoded directly into a buffer of exactly its size.
+  *size = message.size;
+  uint8_t* out = new uint8_t[*size];
+  *data = out;
+  if (message.size == 0) {
+    return message.num_bits == 0;
+  }
+  return tables_[message.table]->DecodeInto(
+      message.bits, message.num_bits, static_cast<uint64_t>(message.size), out);
+}
+}  // namespace compression
@@ -0,0 +1,105 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// These classes compress many small messages together. Building a Huffman
+// table costs far more than coding a few hundred bytes with it, so rather
+// than giving each message its own table, the messages of a batch share one
+// table, or are clustered among a few tables. Each message remains
+// individually decodable.
+//
+// The format begins with a one-byte table count, followed by that many
+// serialized |huffman::Huffman| histograms. Next is the number of messages,
+// and then for each message its table (omitted if there is only one table),
+// its uncompressed size and its coded size in bits. All of these counts are
+// variable-length integers: seven bits per byte, least significant first,
+// with the high bit set on every byte but the last. Finally, the coded
+// messages follow in order, each beginning on a byte boundary.
+
+#ifndef HUFFMAN_COMPRESSION_BATCH_H_
+#define HUFFMAN_COMPRESSION_BATCH_H_
+
+#include <cstdint>
+
+#include <memory>
+#include <vector>
+
+#include "compression/huffman/huffman.h"
+
+namespace compression {
+// A message to be compressed. The data is not owned.
+struct Span {
+  const void* data;
+  int64_t size;
+};
+
+// The most tables a batch may use.
+static constexpr int kMaxBatchTables = 255;
+
+class BatchEncoder {
+ public:
+  // Messages are clustered among at most |max_tables| tables, which must be
+  // between |1| and |kMaxBatchTables|.
+  explicit BatchEncoder(int max_tables = 1) : max_tables_(max_tables) {}
+
+  // Encodes |messages| in the format described above.
+  // NOTE: the calling context is responsible for deleting this pointer
+  void Encode(const std::vector<Span>& messages,
+              void** buffer, int64_t* buffer_size);
+
+ private:
+  // Assigns each message to the table which codes it in the fewest bits,
+  // among those which can code it at all.
+  void Assign(const std::vector<Span>& messages);
+
+  // Rebuilds each table from the messages assigned to it, dropping tables
+  // which have no messages.
+  void Rebuild(const std::vector<Span>& messages);
+
+  int max_tables_;
+
+  // These are retained between batches so that their storage is reused.
+  std::vector<std::unique_ptr<huffman::Huffman>> tables_ = {};
+  std::vector<size_t> assignment_ = {};
+  std::vector<uint64_t> bits_ = {};
+};  // class BatchEncoder
+
+class BatchDecoder {
+ public:
+  BatchDecoder() {}
+
+  // Parses the tables and message index of a batch. |buffer| is not copied,
+  // and must outlive any calls to |Decode|.
+  //
+  // Returns true if and only if the batch was well-formed.
+  bool Init(const void* buffer, int64_t size);
+
+  // Returns the number of messages in the batch.
+  int64_t size() const {
+    return static_cast<int64_t>(messages_.size());
+  }
+
+  // Returns the uncompressed size of the |index|th message.
+  int64_t message_size(int64_t index) const {
+    return messages_.at(static_cast<size_t>(index)).size;
+  }
+
+  // Decodes the |index|th message into a newly allocated buffer.
+  // NOTE: the calling context is responsible for deleting this pointer
+  //
+  // Returns true if and only if the message was well-formed.
+  bool Decode(int64_t index, void** data, int64_t* size) const;
+
+ private:
+  struct Message {
+    size_t table;
+    int64_t size;
+    uint64_t num_bits;
+    const uint8_t* bits;
+  };
+
+  std::vector<std::unique_ptr<huffman::Huffman>> tables_ = {};
+  std::vector<Message> messages_ = {};
+};  // class BatchDecoder
+}  // namespace compression
+
+#endif  // HUFFMAN_COMPRESSION_BATCH_H_
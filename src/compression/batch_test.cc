@@ -0,0 +1,128 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// Unit test for batch encoding
+// Assumes Huffman class is sane
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "compression/batch.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+namespace {
+// Encodes and decodes |messages| as a batch with up to |max_tables| tables,
+// printing the compressed size and the time per message. Returns true if
+// and only if every message survived the round trip.
+bool RoundTrip(const string& name, const vector<string>& messages,
+               int max_tables) {
+  vector<compression::Span> spans;
+  int64_t total = 0;
+  for (auto it = messages.cbegin(); it != messages.cend(); ++it) {
+    spans.push_back({it->data(), static_cast<int64_t>(it->size())});
+    total += static_cast<int64_t>(it->size());
+  }
+
+  compression::BatchEncoder encoder(max_tables);
+  void* buffer = nullptr;
+  int64_t buffer_size = -1;
+
+  // The first batch warms up the encoder's storage.
+  encoder.Encode(spans, &buffer, &buffer_size);
+  delete[] reinterpret_cast<uint8_t*>(buffer);
+
+  auto start = std::chrono::steady_clock::now();
+  encoder.Encode(spans, &buffer, &buffer_size);
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+
+  compression::BatchDecoder decoder;
+  bool fidelity = decoder.Init(buffer, buffer_size) &&
+      decoder.size() == static_cast<int64_t>(messages.size());
+  for (int64_t i = 0; fidelity && i < decoder.size(); ++i) {
+    void* decoded = nullptr;
+    int64_t size = -1;
+    fidelity &= decoder.Decode(i, &decoded, &size);
+    fidelity &= (string(reinterpret_cast<char*>(decoded),
+                        static_cast<size_t>(size)) ==
+                 messages[static_cast<size_t>(i)]);
+    delete[] reinterpret_cast<uint8_t*>(decoded);
+  }
+
+  cout << name << " (" << max_tables << " tables): " << total << " -> "
+       << buffer_size << " bytes, "
+       << (messages.empty() ? 0 :
+           elapsed / static_cast<int64_t>(messages.size()))
+       << " ns/message\n  Fidelity: " << fidelity << endl;
+
+  delete[] reinterpret_cast<uint8_t*>(buffer);
+  return fidelity;
+}
+
+string RandomMessage(const string& alphabet, size_t size) {
+  string message(size, ' ');
+  for (auto& c : message) {
+    c = alphabet[static_cast<size_t>(rand()) % alphabet.size()];
+  }
+  return message;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool ok = true;
+  srand(1);
+
+  ok &= RoundTrip("Empty batch", {}, 1);
+  ok &= RoundTrip("Empty messages", {"", "", ""}, 4);
+  ok &= RoundTrip("One message", {"hello, world"}, 1);
+
+  // Messages of two kinds, which benefit from separate tables.
+  vector<string> messages;
+  for (int i = 0; i < 4000; ++i) {
+    if (i % 2 == 0) {
+      messages.push_back("{\"id\": " + std::to_string(i) + ", \"body\": \"" +
+                         RandomMessage("abcdefghij ", 170) + "\"}");
+    } else {
+      messages.push_back(RandomMessage("0123456789ABCDEF", 200));
+    }
+    if (i % 100 == 0) {
+      messages.push_back("");
+    }
+  }
+  ok &= RoundTrip("Mixed messages", messages, 1);
+  ok &= RoundTrip("Mixed messages", messages, 4);
+
+  // A message may not claim more symbols than it has bits. The batch of
+  // one two-byte message ends with its size, its bit count and its byte of
+  // bits; the size is replaced with 2^42.
+  compression::BatchEncoder encoder;
+  void* buffer = nullptr;
+  int64_t buffer_size = -1;
+  encoder.Encode({{"ab", 2}}, &buffer, &buffer_size);
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(buffer);
+  vector<uint8_t> bomb(bytes, bytes + buffer_size - 3);
+  for (int i = 0; i < 6; ++i) {
+    bomb.push_back(0x80);
+  }
+  bomb.push_back(0x01);
+  bomb.insert(bomb.end(), bytes + buffer_size - 2, bytes + buffer_size);
+  delete[] bytes;
+  compression::BatchDecoder decoder;
+  bool bounded =
+      !decoder.Init(bomb.data(), static_cast<int64_t>(bomb.size()));
+  cout << "Oversized message rejected: " << bounded << endl;
+  ok &= bounded;
+
+  cout << "All passed: " << ok << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,383 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+
+#include "compression/block.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#include <vector>
+
+#include "compression/ans/ans.h"
+#include "compression/histogram.h"
+#include "compression/huffman/huffman.h"
+
+#include "base/bitstring.h"
+
+using std::vector;
+
+using base::BitString;
+using compression::ans::Ans;
+using compression::huffman::Huffman;
+
+namespace compression {
+namespace {
+static constexpr int kByteBits = base::kByteBits;
+
+// Symbols are packed in groups of eight, so that each group occupies exactly
+// |kWidth| whole bytes. Templating on the width lets the compiler fully
+// unroll the inner loops into straight-line shifts and masks.
+template <int kWidth>
+void Pack(const uint8_t* in, int64_t size, const uint8_t* index,
+          uint8_t* out) {
+  const uint8_t* end = in + (size - size % kByteBits);
+  for (; in < end; in += kByteBits, out += kWidth) {
+    uint64_t acc = 0;
+    for (int j = 0; j < kByteBits; ++j) {
+      acc = (acc << kWidth) | index[in[j]];
+    }
+    for (int b = 0; b < kWidth; ++b) {
+      out[b] = static_cast<uint8_t>(acc >> (kByteBits * (kWidth - 1 - b)));
+    }
+  }
+
+  // The trailing partial group is padded with zero bits.
+  unsigned remainder = static_cast<unsigned>(size % kByteBits);
+  if (remainder > 0) {
+    uint64_t acc = 0;
+    for (unsigned j = 0; j < remainder; ++j) {
+      acc = (acc << kWidth) | index[in[j]];
+    }
+    acc <<= kWidth * (kByteBits - remainder);
+    unsigned tail_bytes = (remainder * kWidth + kByteBits - 1) / kByteBits;
+    for (unsigned b = 0; b < tail_bytes; ++b) {
+      out[b] = static_cast<uint8_t>(acc >> (kByteBits * (kWidth - 1 - b)));
+    }
+  }
+}
+
+template <int kWidth>
+void Unpack(const uint8_t* in, int64_t size, const uint8_t* alphabet,
+            uint8_t* out) {
+  constexpr uint64_t kMask = (1 << kWidth) - 1;
+
+  uint8_t* end = out + (size - size % kByteBits);
+  for (; out < end; in += kWidth, out += kByteBits) {
+    uint64_t acc = 0;
+    for (int b = 0; b < kWidth; ++b) {
+      acc = (acc << kByteBits) | in[b];
+    }
+    for (int j = 0; j < kByteBits; ++j) {
+      out[j] = alphabet[(acc >> (kWidth * (kByteBits - 1 - j))) & kMask];
+    }
+  }
+
+  unsigned remainder = static_cast<unsigned>(size % kByteBits);
+  if (remainder > 0) {
+    unsigned tail_bytes = (remainder * kWidth + kByteBits - 1) / kByteBits;
+    uint64_t acc = 0;
+    for (unsigned b = 0; b < kWidth; ++b) {
+      acc = (acc << kByteBits) | ((b < tail_bytes) ? in[b] : 0);
+    }
+    for (unsigned j = 0; j < remainder; ++j) {
+      out[j] = alphabet[(acc >> (kWidth * (kByteBits - 1 - j))) & kMask];
+    }
+  }
+}
+
+// Returns the number of bits needed to index an alphabet of |symbols|.
+int PackedWidth(int symbols) {
+  int width = 1;
+  while ((1 << width) < symbols) {
+    ++width;
+  }
+  return width;
+}
+
+int64_t PackedPayloadSize(int64_t size, int width) {
+  return (size * width + kByteBits - 1) / kByteBits;
+}
+
+// Writes the mode and size header and returns a pointer to the payload.
+uint8_t* WriteHeader(BlockMode mode, int64_t size, uint8_t* buffer) {
+  *buffer = mode;
+  uint64_t raw_size = static_cast<uint64_t>(size);
+  memcpy(buffer + 1, &raw_size, sizeof(raw_size));
+  return buffer + kBlockHeaderSize;
+}
+}  // namespace
+
+void EncodeBlock(const void* data, int64_t size,
+                 void** buffer, int64_t* buffer_size) {
+  const uint8_t* values_ptr = reinterpret_cast<const uint8_t*>(data);
+
+  vector<uint64_t> histogram;
+  Huffman::BuildHistogram(data, size, &histogram);
+
+  int num_symbols = 0;
+  uint8_t alphabet[base::kMaxByte];
+  for (size_t i = 0; i < histogram.size(); ++i) {
+    if (histogram[i] > 0) {
+      alphabet[num_symbols++] = static_cast<uint8_t>(i);
+    }
+  }
+
+  // A block of a single repeated byte needs no coding at all.
+  if (num_symbols == 1) {
+    *buffer_size = kBlockHeaderSize + 1;
+    uint8_t* payload = WriteHeader(kConstantBlock, size,
+                                   new uint8_t[*buffer_size]);
+    *payload = alphabet[0];
+    *buffer = payload - kBlockHeaderSize;
+    return;
+  }
+
+  BlockMode mode = kStoredBlock;
+  int64_t best_size = size;
+
+  int width = PackedWidth(num_symbols);
+  if (num_symbols > 1 && num_symbols <= kMaxPackedAlphabet) {
+    int64_t packed_size = 2 + num_symbols + PackedPayloadSize(size, width);
+    if (packed_size < best_size) {
+      mode = kPackedBlock;
+      best_size = packed_size;
+    }
+  }
+
+  // The Huffman size is computed exactly from the code lengths and the
+  // histogram, so that the data is only encoded if Huffman coding wins.
+  Huffman huf;
+  if (num_symbols > 1) {
+    huf.BuildTree(histogram);
+
+    int64_t huffman_size = huf.SerializedSize() + static_cast<int64_t>(
+        sizeof(uint64_t) +
+        (huf.CodedBits(histogram) + kByteBits - 1) / kByteBits);
+    if (huffman_size < best_size) {
+      mode = kHuffmanBlock;
+      best_size = huffman_size;
+    }
+  }
+
+  // The tANS size is only estimated, so the data is coded before tANS is
+  // chosen, and the coded form kept only if it is the smallest.
+  Ans ans;
+  void* ans_bits = nullptr;
+  int64_t ans_bits_size = 0;
+  if (num_symbols > 1) {
+    ans.BuildTable(histogram);
+
+    int64_t ans_estimate = ans.SerializedSize() + static_cast<int64_t>(
+        (ans.CodedBits(histogram) + kByteBits - 1) / kByteBits);
+    if (ans_estimate < best_size) {
+      ans.Encode(data, size, &ans_bits, &ans_bits_size);
+      int64_t ans_size = ans.SerializedSize() + ans_bits_size;
+      if (ans_size < best_size) {
+        mode = kAnsBlock;
+        best_size = ans_size;
+      }
+    }
+  }
+
+  switch (mode) {
+    case kPackedBlock: {
+      uint8_t index[base::kMaxByte] = {};
+      for (int i = 0; i < num_symbols; ++i) {
+        index[alphabet[i]] = i;
+      }
+
+      *buffer_size = kBlockHeaderSize + best_size;
+      uint8_t* payload = WriteHeader(kPackedBlock, size,
+                                     new uint8_t[*buffer_size]);
+      *buffer = payload - kBlockHeaderSize;
+      payload[0] = width;
+      payload[1] = num_symbols;
+      memcpy(payload + 2, alphabet, static_cast<size_t>(num_symbols));
+      payload += 2 + num_symbols;
+
+      switch (width) {
+        case 1: Pack<1>(values_ptr, size, index, payload); break;
+        case 2: Pack<2>(values_ptr, size, index, payload); break;
+        case 3: Pack<3>(values_ptr, size, index, payload); break;
+        case 4: Pack<4>(values_ptr, size, index, payload); break;
+        default: assert(false);
+      }
+      break;
+    }
+    case kHuffmanBlock: {
+      void* header = nullptr;
+      int64_t header_size = 0;
+      huf.Serialize(&header, &header_size);
+
+      if (size >= Huffman::kPairTableMinSymbols) {
+        huf.BuildMap();
+      }
+      BitString bits;
+      huf.Encode(data, size, &bits);
+
+      void* bits_buffer = nullptr;
+      int64_t bits_size = 0;
+      bits.Serialize(&bits_buffer, &bits_size);
+
+      *buffer_size = kBlockHeaderSize + header_size + bits_size;
+      uint8_t* payload = WriteHeader(kHuffmanBlock, size,
+                                     new uint8_t[*buffer_size]);
+      *buffer = payload - kBlockHeaderSize;
+      memcpy(payload, header, static_cast<size_t>(header_size));
+      memcpy(payload + header_size, bits_buffer,
+             static_cast<size_t>(bits_size));
+      delete[] reinterpret_cast<uint8_t*>(header);
+      delete[] reinterpret_cast<uint8_t*>(bits_buffer);
+      break;
+    }
+    case kAnsBlock: {
+      void* header = nullptr;
+      int64_t header_size = 0;
+      ans.Serialize(&header, &header_size);
+
+      *buffer_size = kBlockHeaderSize + header_size + ans_bits_size;
+      uint8_t* payload = WriteHeader(kAnsBlock, size,
+                                     new uint8_t[*buffer_size]);
+      *buffer = payload - kBlockHeaderSize;
+      memcpy(payload, header, static_cast<size_t>(header_size));
+      memcpy(payload + header_size, ans_bits,
+             static_cast<size_t>(ans_bits_size));
+      delete[] reinterpret_cast<uint8_t*>(header);
+      break;
+    }
+    case kStoredBlock:
+    default: {
+      *buffer_size = kBlockHeaderSize + size;
+      uint8_t* payload = WriteHeader(kStoredBlock, size,
+                                     new uint8_t[*buffer_size]);
+      *buffer = payload - kBlockHeaderSize;
+      if (size > 0) {
+        memcpy(payload, data, static_cast<size_t>(size));
+      }
+      break;
+    }
+  }
+  delete[] reinterpret_cast<uint8_t*>(ans_bits);
+}
+
+bool DecodeBlock(const void* buffer, int64_t buffer_size,
+                 void** data, int64_t* size, int64_t max_size) {
+  if (buffer_size < kBlockHeaderSize) {
+    return false;
+  }
+
+  const uint8_t* byte_ptr = reinterpret_cast<const uint8_t*>(buffer);
+  uint64_t raw_size;
+  memcpy(&raw_size, byte_ptr + 1, sizeof(raw_size));
+  if (max_size < 0 || raw_size > static_cast<uint64_t>(max_size)) {
+    return false;
+  }
+
+  const uint8_t* payload = byte_ptr + kBlockHeaderSize;
+  int64_t payload_size = buffer_size - kBlockHeaderSize;
+
+  switch (*byte_ptr) {
+    case kStoredBlock: {
+      if (payload_size != static_cast<int64_t>(raw_size)) {
+        return false;
+      }
+      *size = static_cast<int64_t>(raw_size);
+      *data = new uint8_t[*size];
+      memcpy(*data, payload, raw_size);
+      return true;
+    }
+    case kConstantBlock: {
+      if (payload_size != 1) {
+        return false;
+      }
+      *size = static_cast<int64_t>(raw_size);
+      *data = new uint8_t[*size];
+      memset(*data, *payload, raw_size);
+      return true;
+    }
+    case kPackedBlock: {
+      if (payload_size < 2) {
+        return false;
+      }
+      int width = payload[0];
+      int num_symbols = payload[1];
+      if (width < 1 || width > 4 ||
+          num_symbols < 2 || num_symbols > (1 << width) ||
+          payload_size != 2 + num_symbols +
+              PackedPayloadSize(static_cast<int64_t>(raw_size), width)) {
+        return false;
+      }
+
+      // Padding the alphabet guarantees that a corrupt index
+      // cannot read past its end.
+      uint8_t alphabet[kMaxPackedAlphabet] = {};
+      memcpy(alphabet, payload + 2, static_cast<size_t>(num_symbols));
+      payload += 2 + num_symbols;
+
+      *size = static_cast<int64_t>(raw_size);
+      uint8_t* out = new uint8_t[*size];
+      *data = out;
+      switch (width) {
+        case 1: Unpack<1>(payload, *size, alphabet, out); break;
+        case 2: Unpack<2>(payload, *size, alphabet, out); break;
+        case 3: Unpack<3>(payload, *size, alphabet, out); break;
+        case 4: Unpack<4>(payload, *size, alphabet, out); break;
+        default: assert(false);
+      }
+      return true;
+    }
+    case kHuffmanBlock: {
+      // The symbol count is checked before any memory is allocated for it.
+      Huffman huf;
+      if (payload_size < 1 || !huf.Unserialize(payload, payload_size) ||
+          huf.symbol_count() != raw_size) {
+        return false;
+      }
+
+      // The serialized |base::BitString| is read in place, rather than
+      // copied into one: a bit count, and then exactly the bytes which hold
+      // that many bits. Every code is at least one bit long.
+      int64_t header_size = Huffman::get_header_size(payload);
+      const uint8_t* bits = payload + header_size;
+      int64_t bits_size = payload_size - header_size;
+      uint64_t num_bits;
+      if (bits_size < static_cast<int64_t>(sizeof(num_bits))) {
+        return false;
+      }
+      memcpy(&num_bits, bits, sizeof(num_bits));
+      bits += sizeof(num_bits);
+      bits_size -= static_cast<int64_t>(sizeof(num_bits));
+      if (num_bits / kByteBits + (num_bits % kByteBits != 0) !=
+              static_cast<uint64_t>(bits_size) ||
+          raw_size > num_bits) {
+        return false;
+      }
+
+      *size = static_cast<int64_t>(raw_size);
+      uint8_t* out = new uint8_t[*size];
+      if (!huf.DecodeInto(bits, num_bits, raw_size, out)) {
+        delete[] out;
+        return false;
+      }
+      *data = out;
+      return true;
+    }
+    case kAnsBlock: {
+      // The symbol count is checked before any memory is allocated for it,
+      // here and again by |Decode|.
+      Ans ans;
+      if (payload_size < 1 || !ans.Unserialize(payload, payload_size) ||
+          ans.symbol_count() != raw_size) {
+        return false;
+      }
+
+      int64_t header_size = SerializedHistogramSize(payload);
+      return ans.Decode(payload + header_size, payload_size - header_size,
+                        data, size, max_size);
+    }
+    default:
+      return false;
+  }
+}
+}  // namespace compression
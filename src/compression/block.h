@@ -0,0 +1,69 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// A block is a self-describing unit of compressed data. Each block records
+// which representation was used to store it, so that the encoder is free
+// to choose whichever representation is smallest for that particular data.
+//
+// The format begins with a nine-byte header: a one-byte |BlockMode| followed
+// by a 64-bit integer giving the number of uncompressed bytes. The payload
+// which follows depends upon the mode:
+//
+//   kStoredBlock:   the uncompressed bytes, verbatim.
+//   kConstantBlock: a single byte, which is repeated for the whole block.
+//   kPackedBlock:   a one-byte code width |w| and a one-byte alphabet size |n|,
+//                   followed by the |n| symbols of the alphabet in ascending
+//                   order and then by the index of each byte into the alphabet
+//                   packed into |w| bits, most significant bit first.
+//   kHuffmanBlock:  a serialized |huffman::Huffman| histogram followed by a
+//                   serialized |base::BitString|.
+//   kAnsBlock:      a serialized |ans::Ans| histogram followed by the coded
+//                   form described in "compression/ans/ans.h", which runs
+//                   to the end of the block.
+
+#ifndef HUFFMAN_COMPRESSION_BLOCK_H_
+#define HUFFMAN_COMPRESSION_BLOCK_H_
+
+#include <cstdint>
+
+namespace compression {
+enum BlockMode : uint8_t {
+  kStoredBlock = 0,
+  kConstantBlock = 1,
+  kPackedBlock = 2,
+  kHuffmanBlock = 3,
+  kAnsBlock = 4,
+};
+
+// The largest alphabet which will be considered for fixed-width packing.
+// Beyond this, a packed code is at least five bits wide and Huffman coding
+// is very nearly always smaller.
+static constexpr int kMaxPackedAlphabet = 16;
+
+// The length of the mode and size header which begins every block.
+static constexpr int kBlockHeaderSize = sizeof(uint8_t) + sizeof(uint64_t);
+
+// The largest block which |DecodeBlock| will decode unless told otherwise.
+// A constant block of a few bytes may claim any size at all, so the size
+// must be bounded before it is allocated.
+static constexpr int64_t kMaxBlockSize = int64_t{1} << 30;
+
+// Encodes the |size| bytes found at |data| as a single block, choosing the
+// smallest of the representations described above.
+// NOTE: the calling context is responsible for deleting this pointer
+void EncodeBlock(const void* data, int64_t size,
+                 void** buffer, int64_t* buffer_size);
+
+// Given a block of the format described above, decode it into a newly
+// allocated buffer.
+// NOTE: the calling context is responsible for deleting this pointer
+//
+// Returns true if and only if the block was well-formed. A block of more
+// than |max_size| uncompressed bytes is rejected before anything is
+// allocated for it.
+bool DecodeBlock(const void* buffer, int64_t buffer_size,
+                 void** data, int64_t* size,
+                 int64_t max_size = kMaxBlockSize);
+}  // namespace compression
+
+#endif  // HUFFMAN_COMPRESSION_BLOCK_H_
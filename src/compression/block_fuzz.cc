@@ -0,0 +1,96 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// Fuzz target for |DecodeBlock|. See "base/fuzz.h".
+//
+// If the first byte of the input is even, the rest is decoded as a block.
+// Otherwise the rest is text: it is encoded as a block, the block is
+// damaged at positions chosen by the bytes which follow the first, and the
+// damaged block is decoded. Random bytes rarely get past the block header,
+// so the second form is what reaches deep into the decoders.
+//
+// Either way, decoding must fail cleanly or give exactly as many bytes as
+// the header claims, within the limit it is given, and anything decoded
+// must survive a round trip.
+
+#include <cstdint>
+#include <cstring>
+
+#include <vector>
+
+#include "base/fuzz.h"
+#include "compression/block.h"
+
+using std::vector;
+
+namespace {
+// Returns the uncompressed size claimed by |block|, or zero if it is too
+// short to have a header.
+uint64_t RawSize(const vector<uint8_t>& block) {
+  uint64_t raw_size = 0;
+  if (block.size() >= static_cast<size_t>(compression::kBlockHeaderSize)) {
+    memcpy(&raw_size, block.data() + 1, sizeof(raw_size));
+  }
+  return raw_size;
+}
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  base::FuzzInput input(data, size);
+  bool damage = input.Byte() % 2 == 1;
+  size_t rest_size;
+  const uint8_t* rest = input.Rest(&rest_size);
+
+  vector<uint8_t> block;
+  if (damage) {
+    void* encoded = nullptr;
+    int64_t encoded_size = -1;
+    compression::EncodeBlock(rest, static_cast<int64_t>(rest_size), &encoded,
+                             &encoded_size);
+    const uint8_t* encoded_bytes = reinterpret_cast<const uint8_t*>(encoded);
+    block.assign(encoded_bytes, encoded_bytes + encoded_size);
+    delete[] encoded_bytes;
+
+    base::FuzzInput damages(rest, rest_size);
+    int num_damages = 1 + damages.Byte() % 4;
+    for (int i = 0; i < num_damages; ++i) {
+      uint64_t at = damages.Below(block.size());
+      block[at] ^= 1 << (damages.Byte() % 8);
+    }
+    if (damages.Byte() % 4 == 0) {
+      block.resize(damages.Below(block.size() + 1));
+    }
+  } else {
+    block.assign(rest, rest + rest_size);
+  }
+
+  // A valid block may claim any size at all, so the limit is lowered to
+  // one which the target can allocate, and which it exercises.
+  void* decoded = nullptr;
+  int64_t decoded_size = -1;
+  if (!compression::DecodeBlock(block.data(),
+                                static_cast<int64_t>(block.size()), &decoded,
+                                &decoded_size, base::kMaxFuzzOutput)) {
+    FUZZ_CHECK(decoded == nullptr);
+    return 0;
+  }
+  FUZZ_CHECK(decoded_size <= base::kMaxFuzzOutput);
+  FUZZ_CHECK(static_cast<uint64_t>(decoded_size) == RawSize(block));
+
+  void* encoded = nullptr;
+  int64_t encoded_size = -1;
+  compression::EncodeBlock(decoded, decoded_size, &encoded, &encoded_size);
+  void* redecoded = nullptr;
+  int64_t redecoded_size = -1;
+  FUZZ_CHECK(compression::DecodeBlock(encoded, encoded_size, &redecoded,
+                                      &redecoded_size));
+  FUZZ_CHECK(redecoded_size == decoded_size);
+  FUZZ_CHECK(decoded_size == 0 ||
+             memcmp(redecoded, decoded,
+                    static_cast<size_t>(decoded_size)) == 0);
+
+  delete[] reinterpret_cast<uint8_t*>(decoded);
+  delete[] reinterpret_cast<uint8_t*>(encoded);
+  delete[] reinterpret_cast<uint8_t*>(redecoded);
+  return 0;
+}
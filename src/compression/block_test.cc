@@ -0,0 +1,129 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// Unit test for block encoding
+// Assumes Huffman and BitString classes are sane
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "compression/block.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+namespace {
+// Passed as the expected mode when any representation is acceptable.
+constexpr uint8_t kAnyMode = 0xFF;
+
+const char* ModeName(uint8_t mode) {
+  switch (mode) {
+    case compression::kStoredBlock: return "stored";
+    case compression::kConstantBlock: return "constant";
+    case compression::kPackedBlock: return "packed";
+    case compression::kHuffmanBlock: return "huffman";
+    case compression::kAnsBlock: return "ans";
+    default: return "unknown";
+  }
+}
+
+// Encodes and decodes |data|, printing the chosen mode and compressed size.
+// Returns true if and only if the data survived the round trip and the
+// expected mode was chosen.
+bool RoundTrip(const string& name, const vector<uint8_t>& data,
+               uint8_t expected_mode) {
+  void* buffer = nullptr;
+  int64_t buffer_size = -1;
+  int64_t data_size = static_cast<int64_t>(data.size());
+  compression::EncodeBlock(data.data(), data_size, &buffer, &buffer_size);
+  uint8_t mode = *reinterpret_cast<uint8_t*>(buffer);
+
+  void* decoded = nullptr;
+  int64_t size = -1;
+  bool sane = compression::DecodeBlock(buffer, buffer_size, &decoded, &size);
+  bool fidelity = sane && size == data_size &&
+      (size == 0 || memcmp(decoded, data.data(), data.size()) == 0);
+
+  cout << name << ": " << data.size() << " -> " << buffer_size
+       << " bytes (" << ModeName(mode) << ")"
+       << "\n  Fidelity: " << fidelity << endl;
+
+  delete[] reinterpret_cast<uint8_t*>(buffer);
+  delete[] reinterpret_cast<uint8_t*>(decoded);
+  return fidelity && (expected_mode == kAnyMode || mode == expected_mode);
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool ok = true;
+
+  ok &= RoundTrip("Empty", {}, compression::kStoredBlock);
+  ok &= RoundTrip("Constant", vector<uint8_t>(100000, 'a'),
+                  compression::kConstantBlock);
+
+  // Uniformly distributed alphabets of each packed width, with lengths that
+  // exercise the trailing partial group. Huffman coding cannot beat packing
+  // when the alphabet is a power of two, but may when it is not.
+  srand(1);
+  const int kAlphabets[] = {2, 3, 4, 5, 8, 9, 16};
+  for (int symbols : kAlphabets) {
+    for (int length : {7, 8, 9, 4099}) {
+      vector<uint8_t> data(static_cast<size_t>(length));
+      for (int i = 0; i < length; ++i) {
+        data[static_cast<size_t>(i)] =
+            'A' + ((i < symbols) ? i : rand() % symbols);
+      }
+      bool power_of_two = (symbols & (symbols - 1)) == 0;
+      uint8_t expected = (length > 1000 && power_of_two)
+          ? uint8_t{compression::kPackedBlock} : kAnyMode;
+      ok &= RoundTrip(std::to_string(symbols) + " symbols, length " +
+                      std::to_string(length), data, expected);
+    }
+  }
+
+  // A skewed alphabet is cheaper to entropy code than to pack, and tANS
+  // spends much less than the one bit a Huffman code must spend on the
+  // common symbol.
+  vector<uint8_t> skewed(100000, 'x');
+  for (size_t i = 0; i < skewed.size(); i += 50) {
+    skewed[i] = 'a' + (i / 50) % 16;
+  }
+  ok &= RoundTrip("Skewed", skewed, compression::kAnsBlock);
+
+  // Uniform random bytes are incompressible.
+  vector<uint8_t> random(100000);
+  for (auto& c : random) {
+    c = rand();
+  }
+  ok &= RoundTrip("Random", random, compression::kStoredBlock);
+
+  // A constant block of a few bytes may claim any size, which must be
+  // refused rather than allocated.
+  uint8_t bomb[compression::kBlockHeaderSize + 1] = {
+    compression::kConstantBlock};
+  uint64_t claimed = uint64_t{1} << 46;
+  memcpy(bomb + 1, &claimed, sizeof(claimed));
+  void* decoded = nullptr;
+  int64_t size = -1;
+  bool bounded = !compression::DecodeBlock(bomb, sizeof(bomb), &decoded,
+                                           &size);
+  claimed = 100;
+  memcpy(bomb + 1, &claimed, sizeof(claimed));
+  bounded &= !compression::DecodeBlock(bomb, sizeof(bomb), &decoded, &size,
+                                       99);
+  bounded &= compression::DecodeBlock(bomb, sizeof(bomb), &decoded, &size,
+                                      100) && size == 100;
+  delete[] reinterpret_cast<uint8_t*>(decoded);
+  cout << "Oversized blocks rejected: " << bounded << endl;
+  ok &= bounded;
+
+  cout << "All passed: " << ok << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,226 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+
+#include "compression/columnar.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#include <vector>
+
+#include "compression/block.h"
+
+#include "base/bitstring.h"
+
+using std::vector;
+
+using base::kByteBits;
+
+namespace compression {
+namespace {
+template <typename T>
+T ZigZag(T value) {
+  constexpr int kBits = sizeof(T) * kByteBits;
+  return static_cast<T>(static_cast<T>(value << 1) ^
+                        static_cast<T>(0 - (value >> (kBits - 1))));
+}
+
+template <typename T>
+T UnZigZag(T value) {
+  return static_cast<T>(static_cast<T>(value >> 1) ^
+                        static_cast<T>(0 - (value & 1)));
+}
+
+// Scatters the bytes of each element into their planes. Templating on the
+// element type and transform lets the compiler fully unroll the byte loop
+// and hoist the delta test out of the element loop.
+template <typename T, bool kDelta>
+void Split(const uint8_t* in, int64_t count, uint8_t* planes) {
+  constexpr int kWidth = sizeof(T);
+
+  T previous = 0;
+  for (int64_t i = 0; i < count; ++i) {
+    T value;
+    memcpy(&value, in + i * kWidth, kWidth);
+    if (kDelta) {
+      T difference = static_cast<T>(value - previous);
+      previous = value;
+      value = ZigZag(difference);
+    }
+    for (int b = 0; b < kWidth; ++b) {
+      planes[b * count + i] =
+          static_cast<uint8_t>(value >> (kByteBits * b));
+    }
+  }
+}
+
+template <typename T, bool kDelta>
+void Merge(const uint8_t* planes, int64_t count, uint8_t* out) {
+  constexpr int kWidth = sizeof(T);
+
+  T previous = 0;
+  for (int64_t i = 0; i < count; ++i) {
+    T value = 0;
+    for (int b = 0; b < kWidth; ++b) {
+      value |= static_cast<T>(static_cast<T>(planes[b * count + i])
+                              << (kByteBits * b));
+    }
+    if (kDelta) {
+      value = static_cast<T>(UnZigZag(value) + previous);
+      previous = value;
+    }
+    memcpy(out + i * kWidth, &value, kWidth);
+  }
+}
+
+template <typename T>
+void Split(const uint8_t* in, int64_t count, bool delta, uint8_t* planes) {
+  if (delta) {
+    Split<T, true>(in, count, planes);
+  } else {
+    Split<T, false>(in, count, planes);
+  }
+}
+
+template <typename T>
+void Merge(const uint8_t* planes, int64_t count, bool delta, uint8_t* out) {
+  if (delta) {
+    Merge<T, true>(planes, count, out);
+  } else {
+    Merge<T, false>(planes, count, out);
+  }
+}
+
+bool ValidWidth(int width) {
+  return width == 1 || width == 2 || width == 4 || width == 8;
+}
+}  // namespace
+
+bool EncodeColumn(const void* data, int64_t count, int width, bool delta,
+                  void** buffer, int64_t* buffer_size) {
+  *buffer = nullptr;
+  *buffer_size = 0;
+  if (!ValidWidth(width) || count < 0 || count > kMaxBlockSize) {
+    return false;
+  }
+
+  const uint8_t* values_ptr = reinterpret_cast<const uint8_t*>(data);
+  size_t plane_size = static_cast<size_t>(count);
+  vector<uint8_t> planes(plane_size * static_cast<size_t>(width));
+
+  switch (width) {
+    case 1: Split<uint8_t>(values_ptr, count, delta, planes.data()); break;
+    case 2: Split<uint16_t>(values_ptr, count, delta, planes.data()); break;
+    case 4: Split<uint32_t>(values_ptr, count, delta, planes.data()); break;
+    case 8: Split<uint64_t>(values_ptr, count, delta, planes.data()); break;
+    default: assert(false);
+  }
+
+  // Each plane is encoded independently so that it receives its own table.
+  vector<void*> blocks(static_cast<size_t>(width), nullptr);
+  vector<int64_t> block_sizes(blocks.size(), 0);
+  *buffer_size = kColumnHeaderSize;
+  for (size_t p = 0; p < blocks.size(); ++p) {
+    EncodeBlock(planes.data() + p * plane_size, count,
+                &blocks[p], &block_sizes[p]);
+    *buffer_size += static_cast<int64_t>(sizeof(uint64_t)) + block_sizes[p];
+  }
+
+  uint8_t* working_buf = new uint8_t[*buffer_size];
+  *buffer = working_buf;
+
+  working_buf[0] = width;
+  working_buf[1] = delta ? kColumnDelta : 0;
+  uint64_t element_count = static_cast<uint64_t>(count);
+  memcpy(working_buf + 2, &element_count, sizeof(element_count));
+  working_buf += kColumnHeaderSize;
+
+  for (size_t p = 0; p < blocks.size(); ++p) {
+    uint64_t frame_size = static_cast<uint64_t>(block_sizes[p]);
+    memcpy(working_buf, &frame_size, sizeof(frame_size));
+    memcpy(working_buf + sizeof(frame_size), blocks[p], frame_size);
+    working_buf += sizeof(frame_size) + frame_size;
+    delete[] reinterpret_cast<uint8_t*>(blocks[p]);
+  }
+  return true;
+}
+
+bool DecodeColumn(const void* buffer, int64_t buffer_size,
+                  void** data, int64_t* count, int* width) {
+  if (buffer_size < kColumnHeaderSize) {
+    return false;
+  }
+
+  const uint8_t* byte_ptr = reinterpret_cast<const uint8_t*>(buffer);
+  int element_width = byte_ptr[0];
+  uint8_t flags = byte_ptr[1];
+  uint64_t element_count;
+  memcpy(&element_count, byte_ptr + 2, sizeof(element_count));
+
+  // Each plane is a block, so a column has no more elements than a block
+  // has bytes.
+  if (!ValidWidth(element_width) || (flags & ~kColumnDelta) != 0 ||
+      element_count > static_cast<uint64_t>(kMaxBlockSize)) {
+    return false;
+  }
+
+  int64_t num_elements = static_cast<int64_t>(element_count);
+  const uint8_t* end = byte_ptr + buffer_size;
+  byte_ptr += kColumnHeaderSize;
+
+  // The planes are only allocated once the first has been decoded to the
+  // claimed count, so that a corrupt count is never allocated.
+  vector<uint8_t> planes;
+  for (int p = 0; p < element_width; ++p) {
+    uint64_t frame_size;
+    if (end - byte_ptr < static_cast<int64_t>(sizeof(frame_size))) {
+      return false;
+    }
+    memcpy(&frame_size, byte_ptr, sizeof(frame_size));
+    byte_ptr += sizeof(frame_size);
+    if (frame_size > static_cast<uint64_t>(end - byte_ptr)) {
+      return false;
+    }
+
+    void* plane = nullptr;
+    int64_t plane_size = -1;
+    if (!DecodeBlock(byte_ptr, static_cast<int64_t>(frame_size), &plane,
+                     &plane_size)) {
+      return false;
+    }
+    bool sane = (plane_size == num_elements);
+    if (sane && p == 0) {
+      planes.resize(element_count * static_cast<uint64_t>(element_width));
+    }
+    if (sane && plane_size > 0) {
+      memcpy(planes.data() + p * num_elements, plane, element_count);
+    }
+    delete[] reinterpret_cast<uint8_t*>(plane);
+    if (!sane) {
+      return false;
+    }
+    byte_ptr += frame_size;
+  }
+
+  // Every byte of the buffer must belong to a plane.
+  if (byte_ptr != end) {
+    return false;
+  }
+
+  bool delta = (flags & kColumnDelta) != 0;
+  uint8_t* out = new uint8_t[planes.size()];
+  switch (element_width) {
+    case 1: Merge<uint8_t>(planes.data(), num_elements, delta, out); break;
+    case 2: Merge<uint16_t>(planes.data(), num_elements, delta, out); break;
+    case 4: Merge<uint32_t>(planes.data(), num_elements, delta, out); break;
+    case 8: Merge<uint64_t>(planes.data(), num_elements, delta, out); break;
+    default: assert(false);
+  }
+
+  *data = out;
+  *count = num_elements;
+  *width = element_width;
+  return true;
+}
+}  // namespace compression
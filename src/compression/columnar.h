@@ -0,0 +1,57 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// These functions compress arrays of fixed-width elements, such as integers
+// or floating point numbers. Byte-level coding of such arrays mixes the
+// high-order bytes, which are often nearly constant, with the low-order
+// bytes, which are often nearly random. Instead, the array is transposed
+// into byte planes: the |i|th plane holds the |i|th byte of every element.
+// Each plane is then encoded as its own block, with its own histogram.
+//
+// Integer columns may optionally be delta-encoded first. Each element is
+// replaced by its difference from the previous element, zig-zag encoded so
+// that small negative differences also have zero high-order bytes.
+//
+// The format begins with a one-byte element width, a one-byte flags field
+// and a 64-bit element count. It is followed by one frame per byte plane,
+// each of which is a 64-bit block size followed by a block as described in
+// "compression/block.h".
+
+#ifndef HUFFMAN_COMPRESSION_COLUMNAR_H_
+#define HUFFMAN_COMPRESSION_COLUMNAR_H_
+
+#include <cstdint>
+
+namespace compression {
+// Flags describing the transform applied to a column before it was split.
+enum ColumnFlags : uint8_t {
+  kColumnDelta = 1,
+};
+
+// The length of the width, flags and count header which begins every column.
+static constexpr int kColumnHeaderSize =
+    sizeof(uint8_t) + sizeof(uint8_t) + sizeof(uint64_t);
+
+// Encodes the |count| elements of |width| bytes each found at |data|.
+// |width| must be one of 1, 2, 4 or 8. If |delta| is true, the elements are
+// treated as unsigned integers of that width and delta-encoded.
+// NOTE: the calling context is responsible for deleting this pointer
+//
+// Returns false, without allocating, if |width| is not valid or |count| is
+// more than |kMaxBlockSize|, since each plane is encoded as a block and
+// |DecodeColumn| would reject the column; see "compression/block.h".
+bool EncodeColumn(const void* data, int64_t count, int width, bool delta,
+                  void** buffer, int64_t* buffer_size);
+
+// Given a column of the format described above, decode it into a newly
+// allocated buffer of |*count| elements of |*width| bytes each.
+// NOTE: the calling context is responsible for deleting this pointer
+//
+// Returns true if and only if the column was well-formed. Each plane is
+// decoded as a block, so a column of more than |kMaxBlockSize| elements is
+// rejected.
+bool DecodeColumn(const void* buffer, int64_t buffer_size,
+                  void** data, int64_t* count, int* width);
+}  // namespace compression
+
+#endif  // HUFFMAN_COMPRESSION_COLUMNAR_H_
@@ -0,0 +1,149 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// Unit test for columnar encoding
+// Assumes block encoding is sane
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "compression/block.h"
+#include "compression/columnar.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+namespace {
+// Encodes and decodes |data| as a column, printing its compressed size
+// beside that of a single byte-level block. Returns true if and only if
+// the data survived the round trip and, if |smaller| is true, the column
+// was smaller than the block.
+template <typename T>
+bool RoundTrip(const string& name, const vector<T>& data, bool delta,
+               bool smaller) {
+  int64_t data_size = static_cast<int64_t>(data.size());
+  void* buffer = nullptr;
+  int64_t buffer_size = -1;
+  bool encoded = compression::EncodeColumn(data.data(), data_size, sizeof(T),
+                                           delta, &buffer, &buffer_size);
+
+  void* block = nullptr;
+  int64_t block_size = -1;
+  compression::EncodeBlock(data.data(), data_size * int64_t{sizeof(T)},
+                           &block, &block_size);
+
+  void* decoded = nullptr;
+  int64_t count = -1;
+  int width = -1;
+  bool sane = compression::DecodeColumn(buffer, buffer_size,
+                                        &decoded, &count, &width);
+  bool fidelity = encoded && sane && count == data_size &&
+      width == sizeof(T) &&
+      (count == 0 ||
+       memcmp(decoded, data.data(), data.size() * sizeof(T)) == 0);
+
+  cout << name << ": " << data.size() * sizeof(T) << " -> " << buffer_size
+       << " bytes (block: " << block_size << ")"
+       << "\n  Fidelity: " << fidelity << endl;
+  bool compact = !smaller || buffer_size < block_size;
+  if (smaller) {
+    cout << "  Smaller than block: " << compact << endl;
+  }
+
+  delete[] reinterpret_cast<uint8_t*>(buffer);
+  delete[] reinterpret_cast<uint8_t*>(block);
+  delete[] reinterpret_cast<uint8_t*>(decoded);
+  return fidelity && compact;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool ok = true;
+  srand(1);
+
+  ok &= RoundTrip("Empty", vector<int32_t>(), false, false);
+
+  // A slowly increasing counter, such as a timestamp column.
+  vector<int64_t> timestamps(100000);
+  int64_t now = 1476000000000;
+  for (auto& t : timestamps) {
+    now += 1000 + rand() % 16;
+    t = now;
+  }
+  ok &= RoundTrip("Timestamps", timestamps, false, true);
+  ok &= RoundTrip("Timestamps (delta)", timestamps, true, true);
+
+  // A small signed integer which wanders up and down around zero.
+  vector<int32_t> walk(100000);
+  int32_t position = 0;
+  for (auto& w : walk) {
+    position += rand() % 7 - 3;
+    w = position;
+  }
+  ok &= RoundTrip("Random walk", walk, false, true);
+  ok &= RoundTrip("Random walk (delta)", walk, true, true);
+
+  vector<int16_t> shorts(100001);
+  for (auto& s : shorts) {
+    s = rand() % 600 - 300;
+  }
+  ok &= RoundTrip("Shorts", shorts, false, false);
+  ok &= RoundTrip("Shorts (delta)", shorts, true, false);
+
+  vector<float> floats(100000);
+  for (size_t i = 0; i < floats.size(); ++i) {
+    floats[i] = 20.0f + std::sin(i / 1000.0f) * 5.0f;
+  }
+  ok &= RoundTrip("Floats", floats, false, false);
+
+  vector<double> doubles(100000);
+  for (size_t i = 0; i < doubles.size(); ++i) {
+    doubles[i] = static_cast<double>(rand() % 100000) / 100.0;
+  }
+  ok &= RoundTrip("Doubles", doubles, false, false);
+
+  vector<uint8_t> bytes(100000);
+  for (auto& b : bytes) {
+    b = rand() % 3;
+  }
+  ok &= RoundTrip("Bytes (delta)", bytes, true, false);
+
+  // A header may claim any number of elements, which must be refused rather
+  // than allocated.
+  uint8_t header[compression::kColumnHeaderSize] = {8, 0};
+  uint64_t claimed = uint64_t{1} << 60;
+  memcpy(header + 2, &claimed, sizeof(claimed));
+  void* decoded = nullptr;
+  int64_t count = -1;
+  int width = -1;
+  bool bounded = !compression::DecodeColumn(header, sizeof(header), &decoded,
+                                            &count, &width);
+  claimed = 1 << 20;
+  memcpy(header + 2, &claimed, sizeof(claimed));
+  bounded &= !compression::DecodeColumn(header, sizeof(header), &decoded,
+                                        &count, &width);
+  cout << "Oversized columns rejected: " << bounded << endl;
+  ok &= bounded;
+
+  // Nor may a column be written with more elements than a block holds. The
+  // count is refused before the data is read.
+  void* buffer = nullptr;
+  int64_t buffer_size = -1;
+  bool refused = !compression::EncodeColumn(
+      bytes.data(), compression::kMaxBlockSize + 1, 1, false, &buffer,
+      &buffer_size);
+  refused &= buffer == nullptr && buffer_size == 0;
+  cout << "Oversized columns refused: " << refused << endl;
+  ok &= refused;
+
+  cout << "All passed: " << ok << endl;
+  return ok ? 0 : 1;
+}
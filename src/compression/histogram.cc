@@ -0,0 +1,211 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+
+#include "compression/histogram.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <vector>
+
+#include "base/bitstring.h"
+
+using std::vector;
+
+namespace compression {
+namespace {
+static constexpr int kBreakEvenHistogramSize = 204;
+static constexpr int kEntryWidth = sizeof(uint8_t) + sizeof(uint32_t);
+static constexpr uint8_t kScaledHistogram = 255;
+
+static constexpr int64_t kFullSize = sizeof(uint32_t) * base::kMaxByte;
+}  // namespace
+
+void BuildHistogram(const void* text, int64_t size,
+                    vector<uint64_t>* histogram) {
+  const uint8_t* values_ptr = reinterpret_cast<const uint8_t*>(text);
+
+  // Runs of a single byte would otherwise make every increment wait on the
+  // one before it, so four tables are counted in turn and then summed.
+  constexpr size_t kTables = 4;
+  uint64_t counts[kTables][base::kMaxByte] = {};
+  size_t num_values = static_cast<size_t>(size);
+  size_t i = 0;
+  for (; num_values - i >= kTables; i += kTables) {
+    for (size_t t = 0; t < kTables; ++t) {
+      ++counts[t][values_ptr[i + t]];
+    }
+  }
+  for (; i < num_values; ++i) {
+    ++counts[0][values_ptr[i]];
+  }
+
+  histogram->assign(base::kMaxByte, 0);
+  for (size_t t = 0; t < kTables; ++t) {
+    for (size_t symbol = 0; symbol < histogram->size(); ++symbol) {
+      (*histogram)[symbol] += counts[t][symbol];
+    }
+  }
+}
+
+void ScaleHistogram(const vector<uint64_t>& histogram,
+                    vector<uint32_t>* scaled, uint64_t* symbol_count) {
+  assert(histogram.size() == base::kMaxByte);
+
+  *symbol_count = 0;
+  for (auto it = histogram.cbegin(); it != histogram.cend(); ++it) {
+    *symbol_count += *it;
+  }
+
+  // Find the smallest scale at which the total fits in 32 bits. Rounding
+  // occurring counts up to one adds at most one per symbol.
+  int shift = 0;
+  for (;; ++shift) {
+    uint64_t total = 0;
+    for (auto it = histogram.cbegin(); it != histogram.cend(); ++it) {
+      if (*it > 0) {
+        total += std::max<uint64_t>(*it >> shift, 1);
+      }
+    }
+    if (total <= UINT32_MAX) break;
+  }
+
+  scaled->assign(base::kMaxByte, 0);
+  for (size_t i = 0; i < histogram.size(); ++i) {
+    if (histogram[i] > 0) {
+      (*scaled)[i] = static_cast<uint32_t>(
+          std::max<uint64_t>(histogram[i] >> shift, 1));
+    }
+  }
+}
+
+int64_t HistogramSize(const vector<uint32_t>& histogram,
+                      uint64_t symbol_count) {
+  assert(histogram.size() == base::kMaxByte);
+
+  int count_nonzero = 0;
+  uint64_t total = 0;
+  for (auto it = histogram.cbegin(); it != histogram.cend(); ++it) {
+    count_nonzero += (*it > 0);
+    total += *it;
+  }
+
+  if (total != symbol_count) {
+    return 1 + sizeof(symbol_count) + kFullSize;
+  } else if (count_nonzero == 0 || count_nonzero > kBreakEvenHistogramSize) {
+    return 1 + kFullSize;
+  }
+  return 1 + count_nonzero * kEntryWidth;
+}
+
+void WriteHistogram(const vector<uint32_t>& histogram,
+                    uint64_t symbol_count, uint8_t* buffer) {
+  assert(histogram.size() == base::kMaxByte);
+
+  int count_nonzero = 0;
+  uint64_t total = 0;
+  for (auto it = histogram.cbegin(); it != histogram.cend(); ++it) {
+    count_nonzero += (*it > 0);
+    total += *it;
+  }
+
+  if (total != symbol_count) {
+    // The histogram was scaled, so the true symbol count must be stored
+    // alongside the full histogram.
+    *buffer = kScaledHistogram;
+    memcpy(buffer + 1, &symbol_count, sizeof(symbol_count));
+    memcpy(buffer + 1 + sizeof(symbol_count), histogram.data(), kFullSize);
+  } else if (count_nonzero == 0 || count_nonzero > kBreakEvenHistogramSize) {
+    // An empty histogram cannot be represented in the map format, because
+    // a header byte of |0| indicates the full histogram.
+    *buffer = 0;
+    memcpy(buffer + 1, histogram.data(), kFullSize);
+  } else {
+    // Copy the label and value of each non-zero entry into the buffer
+    *buffer++ = count_nonzero;
+    for (size_t i = 0; i < histogram.size(); ++i) {
+      if (histogram[i] > 0) {
+        *buffer = static_cast<uint8_t>(i);
+        uint32_t value = histogram[i];
+        memcpy(buffer + 1, &value, sizeof(value));
+        buffer += kEntryWidth;
+      }
+    }
+  }
+}
+
+int64_t SerializedHistogramSize(const void* bytes) {
+  uint8_t size = *reinterpret_cast<const uint8_t*>(bytes);
+
+  if (size > 0 && size <= kBreakEvenHistogramSize) {
+    return kEntryWidth*size + 1;
+  } else if (size == kScaledHistogram) {
+    return sizeof(uint64_t) + kFullSize + 1;
+  } else {
+    return kFullSize + 1;
+  }
+}
+
+bool ReadHistogram(const void* bytes, int64_t size,
+                   vector<uint32_t>* histogram, uint64_t* symbol_count) {
+  if (size < 1 || size < SerializedHistogramSize(bytes)) {
+    return false;
+  }
+
+  const uint8_t* byte_ptr = reinterpret_cast<const uint8_t*>(bytes);
+  histogram->assign(base::kMaxByte, 0);
+  int num_entries = *byte_ptr;
+
+  // No header byte between the largest map and the scaled form is written.
+  if (num_entries > kBreakEvenHistogramSize &&
+      num_entries != kScaledHistogram) {
+    return false;
+  }
+
+  if (num_entries == kScaledHistogram) {
+    memcpy(symbol_count, byte_ptr + 1, sizeof(*symbol_count));
+    memcpy(histogram->data(), byte_ptr + 1 + sizeof(*symbol_count),
+           kFullSize);
+  } else if (num_entries == 0) {
+    memcpy(histogram->data(), byte_ptr + 1, kFullSize);
+  } else {
+    // The map lists each symbol which occurs once, in ascending order.
+    int previous = -1;
+    for (const uint8_t* ptr = byte_ptr + 1;
+         ptr < byte_ptr + 1 + kEntryWidth*num_entries;
+         ptr += kEntryWidth) {
+      uint32_t value;
+      memcpy(&value, ptr + 1, sizeof(value));
+      if (*ptr <= previous || value == 0) {
+        return false;
+      }
+      previous = *ptr;
+      (*histogram)[*ptr] = value;
+    }
+  }
+
+  // The counts are scaled to fit in 32 bits before they are written, and
+  // only a scaled histogram has fewer counts than symbols.
+  int count_nonzero = 0;
+  uint64_t total = 0;
+  for (auto it = histogram->cbegin(); it != histogram->cend(); ++it) {
+    count_nonzero += (*it > 0);
+    total += *it;
+  }
+  if (total > UINT32_MAX) {
+    return false;
+  }
+  // A full table is only written when the map would be larger.
+  if (num_entries == 0 && count_nonzero > 0 &&
+      count_nonzero <= kBreakEvenHistogramSize) {
+    return false;
+  }
+  if (num_entries == kScaledHistogram) {
+    return *symbol_count > total;
+  }
+  *symbol_count = total;
+  return true;
+}
+}  // namespace compression
@@ -0,0 +1,75 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// These functions read and write the serialized form of a histogram of
+// byte values, which begins every block coded by an entropy coder. The
+// coders differ in how they derive codes from the histogram, but store it
+// the same way.
+//
+// The format begins with a header. This is an unsigned 8-bit int |n|
+// giving the number of non-zero entries in the histogram.
+// This will be at most 204. If there are more than 204 entries
+// in the histogram, or there are none, there is a more efficient method.
+//
+// Subsequently, there will be |n| 5-byte blocks. The first byte is a `char`
+// indicating the character whose data is found subsequently.
+// The remaining bytes are a 32-bit integer representing the number of times
+// that byte occurs in the string.
+//
+// If there are more than 204 (or none), the header byte shall be |0| and it
+// shall be followed by exactly 256 32-bit integers, which will be the full
+// data of the histogram. Because [[205*(5 bytes) > 256*(4 bytes)]], this is
+// more space-efficient than storing only non-zero values for any histogram
+// with more than 204 unique entries.
+//
+// If the counts were scaled down to fit in 32 bits, the header byte shall
+// be |255|. It shall be followed by a 64-bit integer giving the true number
+// of symbols, and then by the full data of the scaled histogram as above.
+
+#ifndef HUFFMAN_COMPRESSION_HISTOGRAM_H_
+#define HUFFMAN_COMPRESSION_HISTOGRAM_H_
+
+#include <cstdint>
+
+#include <vector>
+
+namespace compression {
+// Replaces the contents of |histogram| with the number of times each byte
+// value occurs in the |size| bytes at |text|.
+void BuildHistogram(const void* text, int64_t size,
+                    std::vector<uint64_t>* histogram);
+
+// Scales |histogram| down, if necessary, so that the sum of its counts fits
+// in 32 bits, and replaces the contents of |scaled| with the result. Every
+// symbol which occurs keeps a count of at least one. |*symbol_count| is set
+// to the true number of symbols.
+void ScaleHistogram(const std::vector<uint64_t>& histogram,
+                    std::vector<uint32_t>* scaled, uint64_t* symbol_count);
+
+// Returns the number of bytes which |WriteHistogram| writes for
+// |histogram|, which must have |base::kMaxByte| entries. |symbol_count| is
+// the true number of symbols; if it differs from the sum of the counts, the
+// scaled form is used.
+int64_t HistogramSize(const std::vector<uint32_t>& histogram,
+                      uint64_t symbol_count);
+
+// Writes |histogram| in the format described above. |buffer| must have
+// room for |HistogramSize| bytes.
+void WriteHistogram(const std::vector<uint32_t>& histogram,
+                    uint64_t symbol_count, uint8_t* buffer);
+
+// Given a buffer beginning with a serialized histogram, returns its length
+// in bytes. Only the first byte is read.
+int64_t SerializedHistogramSize(const void* bytes);
+
+// Reads a histogram from the |size| bytes at |bytes|, replacing the
+// contents of |histogram| with |base::kMaxByte| counts and setting
+// |*symbol_count| to the true number of symbols.
+//
+// Returns false if |size| is too short to hold the histogram, or if it is
+// not one which |WriteHistogram| could have written.
+bool ReadHistogram(const void* bytes, int64_t size,
+                   std::vector<uint32_t>* histogram, uint64_t* symbol_count);
+}  // namespace compression
+
+#endif  // HUFFMAN_COMPRESSION_HISTOGRAM_H_
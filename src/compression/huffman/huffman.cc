@@ -7,45 +7,81 @@
 #include <cstdint>
 #include <cstring>  
 
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <queue>    
-#include <unordered_map>
 
 #include "compression/huffman/node.h"
 #include "compression/huffman/comparator.h"
+#include "compression/huffman/kernels.h"
+#include "compression/histogram.h"
 
 #include "base/bitstring.h"
+#include "base/stats.h"
 
 using std::string;
 using std::vector;
 using std::priority_queue;
-using std::unordered_map;
 
 using base::BitString;
 
-using std::cout;
-using std::endl;
 
 namespace compression {
 namespace huffman {
-void Huffman::BuildTree(const void* text, int size) {
-  const uint8_t* values_ptr = reinterpret_cast<const uint8_t*>(text);
+void Huffman::BuildTree(const string& text) {
+  // Include the null terminator, which |Encode| appends to the bitstring.
+  this->BuildTree(text.c_str(), static_cast<int64_t>(text.size()) + 1);
+}
 
-  histogram_ = vector<uint32_t>(base::kMaxByte, 0);
-  for (int i = 0; i < size; ++i) {
-    ++histogram_.at(values_ptr[i]);
-  }
+void Huffman::BuildTree(const void* text, int64_t size) {
+  vector<uint64_t> histogram;
+  BuildHistogram(text, size, &histogram);
+  this->BuildTree(histogram);
+}
+
+void Huffman::BuildHistogram(const void* text, int64_t size,
+                             vector<uint64_t>* histogram) {
+  STATS_TIMER(kHistogramStage);
+  compression::BuildHistogram(text, size, histogram);
+}
+
+void Huffman::BuildTree(const vector<uint64_t>& histogram) {
+  ScaleHistogram(histogram, &histogram_, &symbol_count_);
   this->BuildTree();
 }
 
+// The heap operations of |priority_queue| index with signed integers, and
+// once inlined here they trip -Wstrict-overflow in optimized builds. The
+// queue itself is kept, as it breaks ties between equal frequencies, and so
+// shapes the tree which a serialized histogram rebuilds.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wstrict-overflow"
 void Huffman::BuildTree() {
-  // Create a node for each item in the histogram
+  STATS_TIMER(kTreeStage);
+  delete tree_;
+  tree_ = nullptr;
+  pair_table_.clear();
+
+  // Create a node for each symbol which occurs in the histogram
   priority_queue<Node*, vector<Node*>, Comparator> nodes;
-  for (int i = 0; i < base::kMaxByte; ++i) {
-    nodes.push(Node::BuildLeaf(i, histogram_.at(i)));
+  for (size_t i = 0; i < histogram_.size(); ++i) {
+    if (histogram_.at(i) > 0) {
+      nodes.push(Node::BuildLeaf(static_cast<uint8_t>(i), histogram_.at(i)));
+    }
+  }
+
+  // A tree with a single leaf would assign that leaf the empty code, which
+  // cannot be decoded. Pad the forest with zero-frequency leaves so that the
+  // root is a branch. The padding symbols are chosen deterministically so
+  // that an unserialized histogram rebuilds the same tree.
+  for (size_t i = 0; nodes.size() < 2; ++i) {
+    if (histogram_.at(i) == 0) {
+      nodes.push(Node::BuildLeaf(static_cast<uint8_t>(i), 0));
+    }
   }
 
   // Reduce the forest to a single tree
@@ -58,175 +94,402 @@ void Huffman::BuildTree() {
     nodes.push(Node::BuildBranch(a, b));
   }
   tree_ = nodes.top();
-}
-
-bool Huffman::BuildMap() {
-  if (tree_ == nullptr) return false;
-
-  BitString bits;
-  BuildMap(tree_, &bits);
 
-  return true;
+  codes_.assign(base::kMaxByte, 0);
+  lengths_.assign(base::kMaxByte, 0);
+  max_code_length_ = 0;
+  BuildCodes(tree_, 0, 0);
+  BuildDecodeTable();
+  STATS_MAX(kMaxCodeLength, static_cast<uint64_t>(max_code_length_));
 }
+#pragma GCC diagnostic pop
 
-bool Huffman::BuildMap(Node* fakeroot, BitString* bits) {
+void Huffman::BuildCodes(Node* fakeroot, uint64_t code, int depth) {
   if (fakeroot->is_leaf()) {
-    encode_map_.emplace(fakeroot->get_symbol(), *bits);
-    return true;
+    codes_.at(fakeroot->get_symbol()) = code;
+    lengths_.at(fakeroot->get_symbol()) = depth;
+    max_code_length_ = std::max(max_code_length_, depth);
+    return;
   }
-  bool res = true;
 
-  // Traverse into the left branch
-  bits->Append(false);
-  res &= BuildMap(fakeroot->get_left(), bits);
-  bits->PopBack();
+  // Scaling the histogram bounds the depth of the tree well below this.
+  assert(depth < kernels::kRefillBits);
+  BuildCodes(fakeroot->get_left(), code << 1, depth + 1);
+  BuildCodes(fakeroot->get_right(), (code << 1) | 1, depth + 1);
+}
 
-  // Traverse into the right branch
-  bits->Append(true);
-  res &= BuildMap(fakeroot->get_right(), bits);
-  bits->PopBack();
+void Huffman::BuildDecodeTable() {
+  // Use the smallest table which holds every code, up to a limit beyond
+  // which the table would no longer fit comfortably in the L1 cache.
+  if (max_code_length_ <= 8) {
+    table_bits_ = 8;
+  } else if (max_code_length_ <= 10) {
+    table_bits_ = 10;
+  } else if (max_code_length_ <= 11) {
+    table_bits_ = 11;
+  } else {
+    table_bits_ = 12;
+  }
 
-  return res;
+  // Entries are left at |0| for prefixes of codes longer than the table.
+  decode_table_.assign(1 << table_bits_, 0);
+  for (size_t i = 0; i < lengths_.size(); ++i) {
+    int length = lengths_[i];
+    if (length == 0 || length > table_bits_) continue;
+
+    // Every prefix which begins with this code decodes to this symbol.
+    uint64_t first = codes_[i] << (table_bits_ - length);
+    uint64_t last = first + (1 << (table_bits_ - length));
+    for (uint64_t prefix = first; prefix < last; ++prefix) {
+      decode_table_[prefix] =
+          kernels::MakeEntry(static_cast<uint8_t>(i), length);
+    }
+  }
 }
 
-void Huffman::Encode(const string& text, base::BitString* bits) const {
-  bits->clear();
-  for (auto it = text.cbegin(); it != text.cend(); ++it) {
-    bits->Append(encode_map_.at(*it));
+bool Huffman::BuildMap() {
+  if (tree_ == nullptr) return false;
+  STATS_TIMER(kMapStage);
+
+  // Pairs which are too long, or which include a symbol without a code,
+  // are left at |0|. The latter are never looked up, as |CountBits| rejects
+  // such text before encoding.
+  pair_table_.assign(base::kMaxByte * base::kMaxByte, 0);
+  for (size_t first = 0; first < lengths_.size(); ++first) {
+    if (lengths_[first] == 0) continue;
+    uint32_t* row = pair_table_.data() + (first << 8);
+    for (size_t second = 0; second < lengths_.size(); ++second) {
+      int length = lengths_[first] + lengths_[second];
+      if (lengths_[second] == 0 || length > kernels::kMaxPairLength) continue;
+      row[second] = kernels::MakePairEntry(
+          (codes_[first] << lengths_[second]) | codes_[second], length);
+    }
   }
+  return true;
+}
 
+void Huffman::Encode(const string& text, base::BitString* bits) const {
   // Null-terminate string
-  bits->Append(encode_map_.at(0));
+  this->Encode(text.c_str(), static_cast<int64_t>(text.size()) + 1, bits);
 }
 
 void Huffman::Encode(
-    const void* text, int size, base::BitString* bits) const {
+    const void* text, int64_t size, base::BitString* bits) const {
+  STATS_TIMER(kEncodeStage);
+  // Find the exact length of the output so that it is allocated only once.
+  bits->clear();
+  bits->resize(CountBits(text, size));
+  EncodeWith(reinterpret_cast<const uint8_t*>(text), size, bits->data());
+  STATS_ADD(kSymbols, static_cast<uint64_t>(size));
+  STATS_ADD(kCodedBits, bits->size());
+}
+
+uint64_t Huffman::CountBits(const void* text, int64_t size) const {
   const uint8_t* values_ptr = reinterpret_cast<const uint8_t*>(text);
 
-  bits->clear();
-  for (int i = 0; i < size; ++i) {
-    bits->Append(encode_map_.at(values_ptr[i]));
+  // A symbol without a code has length |0|, so a single check after the
+  // loop suffices.
+  uint64_t num_bits = 0;
+  bool missing = false;
+  for (int64_t i = 0; i < size; ++i) {
+    uint8_t length = lengths_[values_ptr[i]];
+    num_bits += length;
+    missing |= (length == 0);
+  }
+
+  if (missing) {
+    throw std::out_of_range("Symbol does not occur in the histogram");
   }
+  return num_bits;
 }
 
-bool Huffman::Decode(const BitString& bits, void** data, int* size) const {
-  vector<uint8_t> res = {};
-  Node* node_iter = tree_;
-  for (int i = 0; i < bits.size(); ++i) {
-    if (bits.Get(i)) {
-      node_iter = node_iter->get_right();
+void Huffman::EncodeInto(const void* text, int64_t size, uint8_t* bits) const {
+  STATS_TIMER(kEncodeStage);
+  EncodeWith(reinterpret_cast<const uint8_t*>(text), size, bits);
+}
+
+void Huffman::EncodeWith(const uint8_t* values_ptr, int64_t size,
+                         uint8_t* bits) const {
+  // As many codes are accumulated between flushes as will fit in the 56
+  // bits which a flush leaves free.
+  const uint64_t* codes = codes_.data();
+  const uint8_t* lengths = lengths_.data();
+  size_t num_values = static_cast<size_t>(size);
+  if (!pair_table_.empty()) {
+    const uint32_t* pairs = pair_table_.data();
+    int pair_length = std::min(2 * max_code_length_, kernels::kMaxPairLength);
+    if (pair_length <= 14) {
+      kernels::EncodePairs<4>(pairs, codes, lengths, values_ptr, num_values,
+                              bits);
+    } else if (pair_length <= 18) {
+      kernels::EncodePairs<3>(pairs, codes, lengths, values_ptr, num_values,
+                              bits);
     } else {
-      node_iter = node_iter->get_left();
+      kernels::EncodePairs<2>(pairs, codes, lengths, values_ptr, num_values,
+                              bits);
     }
+  } else if (max_code_length_ <= 14) {
+    kernels::Encode<4>(codes, lengths, values_ptr, num_values, bits);
+  } else if (max_code_length_ <= 18) {
+    kernels::Encode<3>(codes, lengths, values_ptr, num_values, bits);
+  } else if (max_code_length_ <= 28) {
+    kernels::Encode<2>(codes, lengths, values_ptr, num_values, bits);
+  } else {
+    kernels::Encode<1>(codes, lengths, values_ptr, num_values, bits);
+  }
+}
+
+bool Huffman::Decode(const BitString& bits, void** data, int64_t* size) const {
+  // Every code is at least one bit long, so a count which could not fit in
+  // the bits is rejected before it is allocated.
+  if (symbol_count_ > bits.size()) {
+    *data = nullptr;
+    *size = 0;
+    return false;
+  }
+  *size = static_cast<int64_t>(symbol_count_);
+  uint8_t* out = new uint8_t[*size];
+  *data = out;
+
+  // Return true if and only if all bits contained usable information
+  return DecodeInto(bits.data(), bits.size(), symbol_count_, out);
+}
+
+bool Huffman::DecodeFrom(const uint8_t* bits, uint64_t num_bits,
+                         vector<uint8_t>* out) const {
+  STATS_TIMER(kDecodeStage);
+  kernels::VectorOutput output(out);
+  if (!DecodeWith(bits, num_bits, 0, &output)) {
+    return false;
+  }
+  STATS_ADD(kSymbols, out->size());
+  STATS_ADD(kCodedBits, num_bits);
+  return true;
+}
+
+bool Huffman::DecodeInto(const uint8_t* bits, uint64_t num_bits,
+                         uint64_t count, uint8_t* out) const {
+  STATS_TIMER(kDecodeStage);
+  kernels::FixedOutput output(out, count);
+  if (!DecodeWith(bits, num_bits, 0, &output) || output.room() != 0) {
+    return false;
+  }
+  STATS_ADD(kSymbols, count);
+  STATS_ADD(kCodedBits, num_bits);
+  return true;
+}
 
-    if (node_iter->is_leaf()) {
-      res.push_back(node_iter->get_symbol());
-      node_iter = tree_;
+void Huffman::BuildCheckpoints(const void* text, int64_t size,
+                               uint64_t interval,
+                               Checkpoints* checkpoints) const {
+  assert(interval > 0);
+  const uint8_t* values_ptr = reinterpret_cast<const uint8_t*>(text);
+
+  checkpoints->interval = interval;
+  checkpoints->symbol_count = static_cast<uint64_t>(size);
+  checkpoints->offsets.clear();
+  checkpoints->offsets.reserve(checkpoints->symbol_count / interval + 1);
+
+  uint64_t offset = 0;
+  for (uint64_t i = 0; i < checkpoints->symbol_count; ++i) {
+    if (i % interval == 0) {
+      checkpoints->offsets.push_back(offset);
     }
+    offset += lengths_[values_ptr[i]];
   }
+}
 
-  *size = res.size();
-  *data = new uint8_t[*size];
-  memcpy(*data, res.data(), *size);
+bool Huffman::DecodeRange(const BitString& bits,
+                          const Checkpoints& checkpoints,
+                          uint64_t first_symbol, uint64_t count,
+                          vector<uint8_t>* out) const {
+  STATS_TIMER(kDecodeStage);
+  out->clear();
+  if (count == 0) {
+    return true;
+  }
+  if (first_symbol >= checkpoints.symbol_count ||
+      count > checkpoints.symbol_count - first_symbol) {
+    return false;
+  }
 
-  // Return true if and only if all bits contained usable information
-  return (node_iter == tree_);
+  uint64_t checkpoint = first_symbol / checkpoints.interval;
+  if (checkpoint >= checkpoints.offsets.size()) {
+    return false;
+  }
+  uint64_t offset = checkpoints.offsets[checkpoint];
+  if (offset >= bits.size()) {
+    return false;
+  }
+
+  out->reserve(count);
+  kernels::RangeOutput output(
+      first_symbol - checkpoint * checkpoints.interval, count, out);
+  uint64_t first_byte = offset / base::kByteBits;
+  DecodeWith(bits.data() + first_byte,
+             bits.size() - first_byte * base::kByteBits,
+             offset % base::kByteBits, &output);
+  return out->size() == count;
 }
 
-void Huffman::Serialize(void** buffer, int* size) const {
-  // Several parts of this function depend upon
-  // the histogram being the proper size.
-  assert(histogram_.size() == base::kMaxByte);
+template <typename Output>
+bool Huffman::DecodeWith(const uint8_t* bits, uint64_t num_bits,
+                         int first_bit, Output* out) const {
+  const uint16_t* table = decode_table_.data();
+  switch (table_bits_) {
+    case 8:
+      return kernels::Decode<8>(table, tree_, bits, num_bits, first_bit, out);
+    case 10:
+      return kernels::Decode<10>(table, tree_, bits, num_bits, first_bit,
+                                 out);
+    case 11:
+      return kernels::Decode<11>(table, tree_, bits, num_bits, first_bit,
+                                 out);
+    case 12:
+      return kernels::Decode<12>(table, tree_, bits, num_bits, first_bit,
+                                 out);
+    default:
+      assert(false);
+      return false;
+  }
+}
+
+void Huffman::Serialize(void** buffer, int64_t* size) const {
+  STATS_TIMER(kSerializeStage);
+  *size = SerializedSize();
+  uint8_t* working_buf = new uint8_t[*size];
+  WriteHistogram(histogram_, symbol_count_, working_buf);
+  *buffer = working_buf;
+}
 
-  // TODO(hxtk): Use map of non-zero elements instead of histogram
-  // if there are sufficiently few nonzero elements as to result in a smaller
-  // header section. This format would use five-byte elements consisting of a
-  // one-byte label and a four-byte quantity.
-  // |205*5 > 1024|, so this format would only be used if there are 204 or fewer
-  // non-zero elements.
+uint64_t Huffman::CodedBits(const vector<uint64_t>& histogram) const {
+  assert(histogram.size() == base::kMaxByte);
 
-  uint8_t count_nonzero = 0;
-  for (auto it = histogram_.cbegin(); it != histogram_.cend(); ++it) {
-    if (*it > 0) {
-      // If the value is nonzero, increment the nonzero count.
-      if(++count_nonzero > kBreakEvenHistogramSize) {
-	// If we have reached breakeven size, there is no reason to continue
-	// and furthermore it puts us at risk of overflow.
-	break;
+  uint64_t num_bits = 0;
+  for (size_t i = 0; i < histogram.size(); ++i) {
+    if (histogram[i] > 0) {
+      if (lengths_[i] == 0) {
+        return UINT64_MAX;
       }
+      num_bits += histogram[i] * lengths_[i];
     }
   }
-  
-  if (count_nonzero > kBreakEvenHistogramSize) {
-    // Create a buffer large enough to hold a one-byte header
-    // followed by the entire histogram.
-    *size = (sizeof(histogram_.front())*histogram_.size()) + 1;
-    uint8_t* working_buf = new uint8_t[*size];
-
-    // This is a magic number indicating a big header in the format.
-    // In future versions, there will be a small header format used, where this
-    // byte will indicate the size of the header segment.
-    *working_buf = 0;
-    *buffer = working_buf;
-
-    // NOTE: copy begins one byte after start of buffer
-    // and copies one less than size of buffer to protect
-    // the header byte at the front.
-    memcpy(*buffer + 1, histogram_.data(), *size - 1);
-  } else {
-    // Render the vector down to a map, which will be smaller
-    // if and only if this branch executes.
-
-    // Provide enough space for all entries and a header byte
-    // Header byte will contain the number of entries.
-    *size = count_nonzero*kEntryWidth + 1;
-    cout << static_cast<uint32_t>(*size) << endl;
-    cout << static_cast<uint32_t>(count_nonzero) << endl;
-    cout << kEntryWidth << endl;
-    uint8_t* working_buf = new uint8_t[*size];
-
-    *working_buf = 0;
-    *buffer = working_buf;
-
-    ++working_buf;
-
-    // Copy the label and value of each non-zero entry into the buffer
-    for (int i = 0; i < histogram_.size(); ++i) {
-      if (histogram_.at(i) > 0) {
-        // Copy label and value into map
-        *working_buf = static_cast<uint8_t>(i);
-        *reinterpret_cast<uint32_t*>(working_buf + 1) = histogram_.at(i);
-
-        working_buf += kEntryWidth;
-      }
+  return num_bits;
+}
+
+int64_t Huffman::SerializedSize() const {
+  return HistogramSize(histogram_, symbol_count_);
+}
+
+int64_t Huffman::CompressedSize(uint64_t num_bits) const {
+  return SerializedSize() + static_cast<int64_t>(
+      sizeof(uint64_t) + (num_bits + base::kByteBits - 1) / base::kByteBits);
+}
+
+int64_t Huffman::CompressedSize(const void* text, int64_t size) {
+  vector<uint64_t> histogram;
+  BuildHistogram(text, size, &histogram);
+
+  Huffman huf;
+  huf.BuildTree(histogram);
+  return huf.CompressedSize(huf.CodedBits(histogram));
+}
+
+int64_t Huffman::EstimateCompressedSize(const void* text, int64_t size,
+                                        int64_t sample_size) {
+  if (sample_size >= size) {
+    return CompressedSize(text, size);
+  }
+
+  // Whole runs are taken at even intervals, so that the sample reflects
+  // every part of the text.
+  const uint8_t* values_ptr = reinterpret_cast<const uint8_t*>(text);
+  int64_t runs = std::max<int64_t>(sample_size / kSampleRun, 1);
+  int64_t stride = size / runs;
+
+  vector<uint64_t> histogram(base::kMaxByte, 0);
+  uint64_t sampled = 0;
+  for (int64_t i = 0; i < runs; ++i) {
+    const uint8_t* run = values_ptr + i * stride;
+    int64_t length = std::min(size - i * stride, int64_t{kSampleRun});
+    for (int64_t j = 0; j < length; ++j) {
+      ++histogram[run[j]];
+    }
+    sampled += static_cast<uint64_t>(length);
+  }
+
+  // The sample is scaled up to the size of the text. Sampled symbols keep
+  // a count of at least one, so that they keep their place in the tree.
+  for (auto it = histogram.begin(); it != histogram.end(); ++it) {
+    if (*it > 0) {
+      *it = std::max<uint64_t>(
+          static_cast<double>(*it) * size / sampled + 0.5, 1);
     }
   }
+
+  Huffman huf;
+  huf.BuildTree(histogram);
+  return huf.CompressedSize(huf.CodedBits(histogram));
 }
 
-bool Huffman::Unserialize(void* bytes, int size) {
-  if (size < Huffman::header_size(bytes)) {
+bool Huffman::Unserialize(const void* bytes, int64_t size) {
+  if (!ReadHistogram(bytes, size, &histogram_, &symbol_count_)) {
     return false;
   }
+  this->BuildTree();
+  return true;
+}
 
-  histogram_.resize(base::kMaxByte);
-  int num_entries = *(reinterpret_cast<const uint8_t*>(bytes));
+void Huffman::EncodeReference(const void* text, int64_t size,
+                              BitString* bits) const {
+  const uint8_t* values_ptr = reinterpret_cast<const uint8_t*>(text);
 
-  if (num_entries == 0) {
-    std::memcpy(histogram_.data(),
-                bytes + 1,
-                histogram_.size() * sizeof(histogram_.front()));
-  } else {
-    for (void* ptr = bytes + 1;
-         ptr < bytes + 1 + kEntryWidth*num_entries;
-         ++ptr) {
-      uint8_t* byte_ptr = reinterpret_cast<uint8_t*>(ptr);
-      uint32_t* int_ptr = reinterpret_cast<uint32_t*>(ptr + 1);
+  vector<bool> path;
+  vector<vector<bool>> paths(base::kMaxByte);
+  if (tree_ != nullptr) {
+    BuildPaths(tree_, &path, &paths);
+  }
 
-      histogram_.at(*byte_ptr) = *int_ptr;
+  bits->clear();
+  for (int64_t i = 0; i < size; ++i) {
+    const vector<bool>& code = paths[values_ptr[i]];
+    if (code.empty()) {
+      throw std::out_of_range("Symbol does not occur in the histogram");
+    }
+    for (bool bit : code) {
+      bits->Append(bit);
     }
   }
-  this->BuildTree();
-  return true;
+}
+
+bool Huffman::DecodeReference(const BitString& bits,
+                              vector<uint8_t>* out) const {
+  const Node* node = tree_;
+  for (uint64_t i = 0; i < bits.size(); ++i) {
+    if (node == nullptr || node->is_leaf()) {
+      return false;
+    }
+    node = bits.Get(i) ? node->get_right() : node->get_left();
+    if (node->is_leaf()) {
+      out->push_back(node->get_symbol());
+      node = tree_;
+    }
+  }
+  return node == tree_;
+}
+
+void Huffman::BuildPaths(const Node* fakeroot, vector<bool>* path,
+                         vector<vector<bool>>* paths) {
+  if (fakeroot->is_leaf()) {
+    (*paths)[fakeroot->get_symbol()] = *path;
+    return;
+  }
+
+  path->push_back(false);
+  BuildPaths(fakeroot->get_left(), path, paths);
+  path->back() = true;
+  BuildPaths(fakeroot->get_right(), path, paths);
+  path->pop_back();
 }
 
 string Huffman::ToString() const {
@@ -237,7 +500,7 @@ string Huffman::ToString() const {
 string Huffman::ToString(Node* fakeroot, int depth) const {
   if (fakeroot->is_leaf()) {
     if (fakeroot->get_frequency() > 0) {
-      return "(" + string({fakeroot->get_symbol()})
+      return "(" + string(1, static_cast<char>(fakeroot->get_symbol()))
           + ", " + std::to_string(fakeroot->get_frequency()) +
           + ", " + std::to_string(depth) + ")";
     } else {
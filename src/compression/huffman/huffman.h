@@ -4,6 +4,10 @@
 // This class encodes and decodes strings using Huffman Coding.
 // Several methods must be called in order, depending on the use.
 //
+// |Checkpoints| are held in memory only. Neither |Serialize| nor the block
+// and archive formats record them, so a caller which needs random access
+// into coded text it has stored must store the index alongside it.
+//
 // TODO: document common execution paths
 
 #ifndef HUFFMAN_HUFFMAN_H_
@@ -15,13 +19,24 @@
 #include <string>
 #include <vector>
 #include <queue>
-#include <unordered_map>
 
+#include "compression/histogram.h"
 #include "compression/huffman/node.h"
 #include "base/bitstring.h"
 
 namespace compression {
 namespace huffman {
+// An index into coded text, allowing symbols to be decoded from the middle
+// of it. |offsets[i]| is the position in bits of the code for symbol
+// |i * interval|. A larger interval makes a smaller index, but more symbols
+// must be decoded and discarded to reach any given one. There is no
+// serialized form; see the note at the top of this file.
+struct Checkpoints {
+  uint64_t interval = 0;
+  uint64_t symbol_count = 0;
+  std::vector<uint64_t> offsets = {};
+};
+
 class Huffman {
  public:  
   Huffman() {}
@@ -39,26 +54,59 @@ class Huffman {
   // in descending order by frequency.
   //
   // Next, execution is passed off to |BuildTree()|
+  //
+  // The string overload includes the terminating null character in the
+  // histogram, as it is appended by the string overload of |Encode|.
   void BuildTree(const std::string& text);
-  void BuildTree(const void* text, int size);
+  void BuildTree(const void* text, int64_t size);
+
+  // This builds the Huffman Coding Tree from a histogram which has already
+  // been computed by the caller. |histogram| must have |base::kMaxByte|
+  // entries.
+  //
+  // If the counts total more than |UINT32_MAX|, they are scaled down by the
+  // smallest power of two which makes them fit, so that they can be stored
+  // in the 32-bit serialized form. Symbols which occur keep a count of at
+  // least one, so they still receive a code.
+  void BuildTree(const std::vector<uint64_t>& histogram);
+
+  // Counts the occurrences of each byte among the |size| bytes at |text|,
+  // replacing the contents of |histogram| with |base::kMaxByte| counts.
+  static void BuildHistogram(const void* text, int64_t size,
+                             std::vector<uint64_t>* histogram);
 
   // NOTE: This must be called AFTER |BuildTree| or |Unserialize|
   //
-  // This function searches through the binary tree
-  // to generate a map from letters to their associated
-  // bitstrings.
+  // This function prepares the tree for encoding long texts by building a
+  // table of the codes for every pair of symbols, so that the encoder
+  // emits two symbols with each lookup. The table has 65536 entries, and
+  // building it costs about as much as encoding |kPairTableMinSymbols|
+  // symbols, so it is worthwhile only for texts at least that long.
+  // Encoding does not depend on it.
   //
-  // Returns |true| on success, |false| on failure.
-  // Failure can indicate that the machine ran out of memory
-  // or that the tree has not yet been initialized.
+  // Returns |true| on success, |false| if the tree has not yet been
+  // initialized.
   bool BuildMap();
 
-  // NOTE: This function must be called AFTER |BuildMap|
+  static constexpr int64_t kPairTableMinSymbols = 1 << 16;
+
+  // NOTE: This function must be called AFTER |BuildTree| or |Unserialize|
+  //
+  // Returns the length in bits of the code assigned to |symbol|, or |0| if
+  // the symbol does not occur in the histogram.
+  int code_length(uint8_t symbol) const {
+    return lengths_.empty() ? 0 : lengths_[symbol];
+  }
+
+  // NOTE: This function must be called AFTER |BuildTree| or |Unserialize|
   //
   // This function accepts a string and encodes it using the Huffman Tree
   // A bitstring is then returned containing the encoded bytestring.
+  //
+  // Throws |std::out_of_range| if the text contains a symbol which does not
+  // occur in the histogram.
   void Encode(const std::string& text, base::BitString* bits) const;
-  void Encode(const void* text, int size, base::BitString* bits) const;
+  void Encode(const void* text, int64_t size, base::BitString* bits) const;
 
   // NOTE: This function must be called AFTER |BuildTree| or |Unserialize|
   // NOTE: This function does NOT depend on |BuildMap|
@@ -73,7 +121,70 @@ class Huffman {
   // A |1| bit indicates (right). A |0| bit indicates left.
   // If the current node is a leaf node, add it to the buffer
   // and reset current node to root.
-  bool Decode(const base::BitString& bits, void** data, int* size) const;
+  //
+  // In practice, the tree is only walked for codes longer than the decode
+  // table. See "compression/huffman/kernels.h".
+  //
+  // The output is allocated once, with room for the |symbol_count()|
+  // symbols counted by the histogram, so the bits must code the text from
+  // which the tree was built.
+  bool Decode(const base::BitString& bits, void** data, int64_t* size) const;
+
+  // NOTE: These functions must be called AFTER |BuildTree| or |Unserialize|
+  //
+  // These are the forms of |Encode| and |Decode| for callers which manage
+  // their own buffers, such as those packing many messages together.
+  // Bits are ordered as they are in a |base::BitString|.
+  //
+  // |CountBits| returns the number of bits which |EncodeInto| will write for
+  // the same text, so that the caller can size the output. It throws
+  // |std::out_of_range| if the text contains a symbol which does not occur
+  // in the histogram.
+  uint64_t CountBits(const void* text, int64_t size) const;
+  void EncodeInto(const void* text, int64_t size, uint8_t* bits) const;
+
+  // Decodes |num_bits| bits beginning at |bits|, appending the symbols to
+  // |out|. Returns true if and only if the bits end on a symbol boundary.
+  bool DecodeFrom(const uint8_t* bits, uint64_t num_bits,
+                  std::vector<uint8_t>* out) const;
+
+  // Decodes |num_bits| bits beginning at |bits| into the |count| bytes at
+  // |out|. Returns true if and only if the bits hold exactly |count|
+  // symbols; otherwise the contents of |out| are unspecified.
+  bool DecodeInto(const uint8_t* bits, uint64_t num_bits, uint64_t count,
+                  uint8_t* out) const;
+
+  // NOTE: These functions must be called AFTER |BuildTree| or |Unserialize|
+  //
+  // |BuildCheckpoints| indexes the coded form of the |size| bytes at |text|,
+  // recording a checkpoint every |interval| symbols. It needs only the code
+  // lengths, so it may be called before or after |Encode|, and the index
+  // may be stored apart from the bits.
+  //
+  // |DecodeRange| decodes the |count| symbols beginning with symbol
+  // |first_symbol|, replacing the contents of |out|. Decoding begins at the
+  // nearest checkpoint at or before |first_symbol|. Returns true if and
+  // only if every requested symbol was decoded.
+  void BuildCheckpoints(const void* text, int64_t size, uint64_t interval,
+                        Checkpoints* checkpoints) const;
+  bool DecodeRange(const base::BitString& bits,
+                   const Checkpoints& checkpoints, uint64_t first_symbol,
+                   uint64_t count, std::vector<uint8_t>* out) const;
+
+  // NOTE: These functions must be called AFTER |BuildTree| or |Unserialize|
+  //
+  // These are the reference forms of |Encode| and |Decode|. They walk the
+  // tree one bit at a time, using none of the tables or kernels, and are
+  // far too slow for real use; they exist so that the optimized forms can
+  // be checked against them.
+  //
+  // |EncodeReference| throws |std::out_of_range| if the text contains a
+  // symbol which has no leaf. |DecodeReference| appends to |out|, and
+  // returns true if and only if the bits end on a symbol boundary.
+  void EncodeReference(const void* text, int64_t size,
+                       base::BitString* bits) const;
+  bool DecodeReference(const base::BitString& bits,
+                       std::vector<uint8_t>* out) const;
 
   // This function returns a pointer to a buffer
   // containing the canonical byte representation of the histogram.
@@ -81,61 +192,135 @@ class Huffman {
   // the Huffman tree deterministically. As such it is used as
   // the canonical serialization of the object.
   //
-  // The format begins with a header. This is an unsigned 8-bit int |n|
-  // giving the number of non-zero entries in the histogram.
-  // This will be at most 204. If there are more than 204 entries
-  // in the histogram, there is a more efficient method.
-  //
-  // Subsequently, there will be |n| 5-byte blocks. The first byte is a `char`
-  // indicating the character whose data is found subsequently.
-  // The remaining bytes are a 32-bit integer representing the number of times
-  // that byte occurs in the string.
-  //
-  // If there are more than 204, the header byte shall be |0| and it shall
-  // be followed by exactly 256 32-bit integers, which will be the full data
-  // of the histogram. Because [[205*(5 bytes) > 256*(4 bytes)]], this is
-  // more space-efficient than storing only non-zero values for any histogram
-  // with more than 204 unique entries.
-  void Serialize(void** buffer, int* size) const;
+  // The format is described in "compression/histogram.h". If the histogram
+  // was scaled down by |BuildTree|, the true number of symbols is stored
+  // with it.
+  void Serialize(void** buffer, int64_t* size) const;
 
   // This accepts the standard serialized string and initializes the object
   // such that it matches the one that was serialized.
   // This is accomplished by first initializing the histogram from the serial
   // string, and then calling |BuildTree()|
-  bool Unserialize(void* bytes, int size);
+  bool Unserialize(const void* bytes, int64_t size);
+
+  // NOTE: These functions must be called AFTER |BuildTree| or |Unserialize|
+  //
+  // These give the size of the output without producing it, so that
+  // callers deciding whether to compress need only count the symbols.
+  //
+  // |CodedBits| returns the number of bits which |Encode| will write for
+  // any text whose histogram is |histogram|, or |UINT64_MAX| if the text
+  // contains a symbol which does not occur in this tree's histogram.
+  uint64_t CodedBits(const std::vector<uint64_t>& histogram) const;
+
+  // |SerializedSize| returns the number of bytes which |Serialize| writes.
+  int64_t SerializedSize() const;
+
+  // Returns the number of bytes taken by the serialized histogram and the
+  // serialized |base::BitString| which coding the |size| bytes at |text|
+  // would produce. This costs a histogram and a tree, but no coding.
+  static int64_t CompressedSize(const void* text, int64_t size);
+
+  // Estimates |CompressedSize| from a sample of about |sample_size| bytes,
+  // taken in short runs spread evenly across the text. Symbols missing
+  // from the sample are not counted, so the estimate is slightly low for
+  // text with many rare symbols. If |sample_size| is at least |size|, the
+  // result is exact.
+  static int64_t EstimateCompressedSize(const void* text, int64_t size,
+                                        int64_t sample_size);
 
   // This returns the canonical string form of the Huffman Coding Tree
   std::string ToString() const;
 
+  // Returns the number of symbols counted by the histogram, before any
+  // scaling was applied.
+  uint64_t symbol_count() const {
+    return symbol_count_;
+  }
+
+  // Returns the length in bits of the longest code in the tree.
+  int max_code_length() const {
+    return max_code_length_;
+  }
+
+  // Given a buffer beginning with the serialized form described above,
+  // these return the length of the serialized histogram and a pointer to the
+  // first byte following it, respectively.
+  static int get_header_size(const void* bytes) {
+    return header_size(bytes);
+  }
+  static const void* get_data_segment(const void* bytes) {
+    return reinterpret_cast<const uint8_t*>(bytes) + header_size(bytes);
+  }
+
  private:
-  static constexpr int kBreakEvenHistogramSize = 204;
-  static constexpr int kEntryWidth = sizeof(uint8_t) + sizeof(int32_t);
+  // The length of the runs which |EstimateCompressedSize| samples.
+  static constexpr int64_t kSampleRun = 64;
+
+  // Returns the size of the histogram and bitstring given the length of
+  // the coded bits.
+  int64_t CompressedSize(uint64_t num_bits) const;
+
+  // Runs the decode kernel which matches |table_bits_|, as described in
+  // "compression/huffman/kernels.h".
+  template <typename Output>
+  bool DecodeWith(const uint8_t* bits, uint64_t num_bits, int first_bit,
+                  Output* out) const;
+
+  // Runs the encode kernel which matches |pair_table_| and
+  // |max_code_length_|. This is |EncodeInto| without its timer, so that
+  // |Encode| is timed as a single call.
+  void EncodeWith(const uint8_t* text, int64_t size, uint8_t* bits) const;
 
   // This is the meat of the |BuildTree| function described above.
   // Using a min heap, the two smallest elements are removed and put back
   // as a single branch node with value equaling the sum of its children.
   // This continues until there is only one node remaining.
+  //
+  // Only symbols which occur in the histogram receive a leaf. If fewer than
+  // two symbols occur, zero-frequency leaves are added so that the root is
+  // always a branch and every symbol receives a code of at least one bit.
   void BuildTree();
+
+  // Fills |codes_| and |lengths_| with the code of every leaf beneath
+  // |fakeroot|, whose own code is the low |depth| bits of |code|.
+  void BuildCodes(Node* fakeroot, uint64_t code, int depth);
+
+  // Chooses the decode table width from the maximum code length, and fills
+  // the table from |codes_| and |lengths_|.
+  void BuildDecodeTable();
   
   // These are the recursive calls for the associated public functions
   // of the same name.
   std::string ToString(Node* fakeroot, int depth) const;
-  bool BuildMap(Node* fakeroot, base::BitString* bits);
 
-  static int header_size(void* bytes) {
-    uint8_t size = *reinterpret_cast<uint8_t*>(bytes);
+  // Appends to |paths| the path from the root to each leaf beneath
+  // |fakeroot|, whose own path is |path|.
+  static void BuildPaths(const Node* fakeroot, std::vector<bool>* path,
+                         std::vector<std::vector<bool>>* paths);
 
-    if (size <= kBreakEvenHistogramSize) {
-      return kEntryWidth*size + 1;
-    } else {
-      return sizeof(int32_t)*base::kMaxByte + 1;
-    }
+  static int header_size(const void* bytes) {
+    return SerializedHistogramSize(bytes);
   }
 
-
   Node* tree_ = nullptr;
-  std::unordered_map<uint8_t, base::BitString> encode_map_ = {};
+
+  // The (possibly scaled) histogram from which the tree is built, and
+  // the true number of symbols it describes.
   std::vector<uint32_t> histogram_ = {};
+  uint64_t symbol_count_ = 0;
+
+  // The code of each symbol, right-aligned, and its length in bits.
+  // A length of |0| indicates that the symbol has no code.
+  std::vector<uint64_t> codes_ = {};
+  std::vector<uint8_t> lengths_ = {};
+  int max_code_length_ = 0;
+
+  // See "compression/huffman/kernels.h". The pair table is empty unless
+  // |BuildMap| has been called.
+  int table_bits_ = 0;
+  std::vector<uint16_t> decode_table_ = {};
+  std::vector<uint32_t> pair_table_ = {};
 };  // class Huffman
 }  // namespace huffman
 }  // namespace compression
@@ -0,0 +1,486 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// This program measures the throughput of each stage of Huffman coding over
+// several generated corpora of increasing size. Each measurement is repeated
+// until it has run for at least |--min_time| seconds, and the mean is
+// reported.
+//
+// Results are printed as a table, or with |--format=csv| or |--format=json|
+// as one record per measurement, so that runs can be compared by a script.
+// Throughput is given in MB/s of uncompressed data, and allocations are
+// counted by replacing the global |operator new|.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+
+#include "base/bitstring.h"
+#include "compression/ans/ans.h"
+#include "compression/block.h"
+#include "compression/huffman/huffman.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+using base::BitString;
+using compression::ans::Ans;
+using compression::huffman::Huffman;
+
+DEFINE_int64(min_size, 1 << 10, "Smallest corpus, in bytes");
+DEFINE_int64(max_size, 1 << 24, "Largest corpus, in bytes; at most 1 GiB");
+DEFINE_int32(size_step, 4, "Factor by which successive corpora grow");
+DEFINE_double(min_time, 0.05, "Seconds for which each stage is repeated");
+DEFINE_string(corpora, "text,random,skewed,sparse", "Corpora to generate");
+DEFINE_string(stages,
+              "histogram,tree,map,estimate,encode,decode,serialize,"
+              "ans_table,ans_encode,ans_decode,block_encode,block_decode",
+              "Stages to measure");
+DEFINE_string(format, "table", "One of table, csv or json");
+
+namespace {
+uint64_t allocations = 0;
+uint64_t allocated_bytes = 0;
+}  // namespace
+
+void* operator new(size_t size) {
+  ++allocations;
+  allocated_bytes += size;
+  void* ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+// Once inlined beside a matching |operator new|, GCC takes these for a
+// mismatched |free| of memory from |new|, so they are kept out of line.
+__attribute__((noinline)) void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+__attribute__((noinline)) void operator delete[](void* ptr) noexcept {
+  free(ptr);
+}
+
+namespace {
+static constexpr int64_t kMaxCorpusSize = int64_t{1} << 30;
+static constexpr double kBytesPerMegabyte = 1e6;
+
+struct Result {
+  string corpus;
+  int64_t size;
+  string stage;
+  int64_t iterations;
+  double ns_per_iteration;
+  double ratio;               // Compressed size over uncompressed size
+  double allocations;         // Per iteration
+  double allocated_bytes;     // Per iteration
+};
+
+vector<string> Split(const string& list) {
+  vector<string> items;
+  std::stringstream stream(list);
+  string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+bool Contains(const vector<string>& items, const string& item) {
+  return std::find(items.begin(), items.end(), item) != items.end();
+}
+
+// English-like text: words drawn from a Zipf-distributed vocabulary of
+// random lowercase words, separated by spaces, with occasional punctuation.
+void GenerateText(std::mt19937_64* rng, int64_t size, vector<uint8_t>* out) {
+  static constexpr int kVocabulary = 2048;
+
+  std::uniform_int_distribution<int> letter('a', 'z');
+  std::uniform_int_distribution<int> word_length(1, 10);
+  vector<string> words(kVocabulary);
+  vector<double> weights(kVocabulary);
+  for (size_t i = 0; i < words.size(); ++i) {
+    int length = word_length(*rng);
+    for (int j = 0; j < length; ++j) {
+      words[i].push_back(static_cast<char>(letter(*rng)));
+    }
+    weights[i] = 1.0 / static_cast<double>(i + 1);
+  }
+
+  std::discrete_distribution<int> word(weights.begin(), weights.end());
+  std::uniform_int_distribution<int> punctuation(0, 15);
+  static const char kPunctuation[] = ".,;\n";
+  while (static_cast<int64_t>(out->size()) < size) {
+    const string& next = words[static_cast<size_t>(word(*rng))];
+    out->insert(out->end(), next.begin(), next.end());
+    int mark = punctuation(*rng);
+    if (mark < 4) {
+      out->push_back(static_cast<uint8_t>(kPunctuation[mark]));
+    }
+    out->push_back(' ');
+  }
+  out->resize(static_cast<size_t>(size));
+}
+
+// Uniformly random bytes, which cannot be compressed.
+void GenerateRandom(std::mt19937_64* rng, int64_t size, vector<uint8_t>* out) {
+  out->resize(static_cast<size_t>(size));
+  for (auto& c : *out) {
+    c = static_cast<uint8_t>((*rng)());
+  }
+}
+
+// Bytes with geometrically decreasing frequency, which give long codes.
+void GenerateSkewed(std::mt19937_64* rng, int64_t size, vector<uint8_t>* out) {
+  std::geometric_distribution<int> symbol(0.3);
+  out->resize(static_cast<size_t>(size));
+  for (auto& c : *out) {
+    c = static_cast<uint8_t>(std::min(symbol(*rng), 255));
+  }
+}
+
+// Mostly zero bytes, with an occasional random byte.
+void GenerateSparse(std::mt19937_64* rng, int64_t size, vector<uint8_t>* out) {
+  std::bernoulli_distribution nonzero(0.05);
+  out->assign(static_cast<size_t>(size), 0);
+  for (auto& c : *out) {
+    if (nonzero(*rng)) {
+      c = static_cast<uint8_t>((*rng)());
+    }
+  }
+}
+
+bool Generate(const string& corpus, int64_t size, vector<uint8_t>* out) {
+  // Each corpus is seeded independently so that it does not depend upon
+  // which other corpora were requested.
+  std::mt19937_64 rng(std::hash<string>()(corpus));
+  out->clear();
+  if (corpus == "text") {
+    GenerateText(&rng, size, out);
+  } else if (corpus == "random") {
+    GenerateRandom(&rng, size, out);
+  } else if (corpus == "skewed") {
+    GenerateSkewed(&rng, size, out);
+  } else if (corpus == "sparse") {
+    GenerateSparse(&rng, size, out);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Runs |stage| repeatedly for at least |FLAGS_min_time| seconds, and at
+// least once, recording the mean time and allocations per run.
+void Measure(const std::function<void()>& stage, Result* result) {
+  typedef std::chrono::steady_clock Clock;
+
+  uint64_t start_allocations = allocations;
+  uint64_t start_bytes = allocated_bytes;
+  Clock::time_point start = Clock::now();
+  Clock::duration budget = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(FLAGS_min_time));
+
+  int64_t iterations = 0;
+  Clock::duration elapsed;
+  do {
+    stage();
+    ++iterations;
+    elapsed = Clock::now() - start;
+  } while (elapsed < budget);
+
+  result->iterations = iterations;
+  result->ns_per_iteration =
+      std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+  result->allocations =
+      static_cast<double>(allocations - start_allocations) / iterations;
+  result->allocated_bytes =
+      static_cast<double>(allocated_bytes - start_bytes) / iterations;
+}
+
+double MegabytesPerSecond(const Result& result) {
+  return result.size / kBytesPerMegabyte /
+      (result.ns_per_iteration / std::nano::den);
+}
+
+double NanosecondsPerSymbol(const Result& result) {
+  return result.size == 0 ? 0 : result.ns_per_iteration / result.size;
+}
+
+// Measures every requested stage over |data|, appending to |results|.
+// Returns false if the data did not survive a round trip.
+bool Run(const string& corpus, const vector<uint8_t>& data,
+         const vector<string>& stages, vector<Result>* results) {
+  int64_t size = static_cast<int64_t>(data.size());
+
+  Result base_result = {corpus, size, "", 0, 0, 0, 0, 0};
+  auto record = [&](const string& stage, double ratio,
+                    const std::function<void()>& run) {
+    if (!Contains(stages, stage)) return;
+    Result result = base_result;
+    result.stage = stage;
+    result.ratio = ratio;
+    Measure(run, &result);
+    results->push_back(result);
+  };
+
+  // The stages which consume the output of another are given one prepared
+  // ahead of time, so that each measures only its own work.
+  // The encoder is prepared as |compression::EncodeBlock| prepares it.
+  Huffman huf;
+  huf.BuildTree(data.data(), size);
+  if (size >= Huffman::kPairTableMinSymbols) {
+    huf.BuildMap();
+  }
+  vector<uint64_t> histogram;
+  Huffman::BuildHistogram(data.data(), size, &histogram);
+
+  BitString bits;
+  huf.Encode(data.data(), size, &bits);
+  void* header = nullptr;
+  int64_t header_size = 0;
+  huf.Serialize(&header, &header_size);
+  delete[] reinterpret_cast<uint8_t*>(header);
+  double huffman_ratio = size == 0 ? 0 :
+      static_cast<double>(header_size + static_cast<int64_t>(
+          sizeof(uint64_t) + (bits.size() + 7) / 8)) /
+      static_cast<double>(size);
+
+  Ans ans;
+  ans.BuildTable(histogram);
+  void* ans_bits = nullptr;
+  int64_t ans_bits_size = 0;
+  ans.Encode(data.data(), size, &ans_bits, &ans_bits_size);
+  double ans_ratio = size == 0 ? 0 :
+      (ans.SerializedSize() + ans_bits_size) / static_cast<double>(size);
+
+  void* block = nullptr;
+  int64_t block_size = 0;
+  compression::EncodeBlock(data.data(), size, &block, &block_size);
+  double block_ratio = size == 0 ? 0 :
+      block_size / static_cast<double>(size);
+
+  // Check the round trips before timing anything.
+  void* decoded = nullptr;
+  int64_t decoded_size = 0;
+  bool sane = huf.Decode(bits, &decoded, &decoded_size) &&
+      decoded_size == size &&
+      (size == 0 || memcmp(decoded, data.data(), data.size()) == 0);
+  delete[] reinterpret_cast<uint8_t*>(decoded);
+  sane &= compression::DecodeBlock(block, block_size, &decoded,
+                                   &decoded_size) &&
+      decoded_size == size &&
+      (size == 0 || memcmp(decoded, data.data(), data.size()) == 0);
+  delete[] reinterpret_cast<uint8_t*>(decoded);
+  sane &= ans.Decode(ans_bits, ans_bits_size, &decoded, &decoded_size,
+                     size) &&
+      decoded_size == size &&
+      (size == 0 || memcmp(decoded, data.data(), data.size()) == 0);
+  delete[] reinterpret_cast<uint8_t*>(decoded);
+  if (!sane) {
+    delete[] reinterpret_cast<uint8_t*>(block);
+    delete[] reinterpret_cast<uint8_t*>(ans_bits);
+    return false;
+  }
+
+  record("histogram", 0, [&]() {
+    vector<uint64_t> counts;
+    Huffman::BuildHistogram(data.data(), size, &counts);
+  });
+  record("tree", 0, [&]() {
+    Huffman tree;
+    tree.BuildTree(histogram);
+  });
+  // The map is built on a tree of its own, so that the stages which follow
+  // run with |huf| as |compression::EncodeBlock| prepared it.
+  Huffman mapped;
+  mapped.BuildTree(histogram);
+  record("map", 0, [&]() {
+    mapped.BuildMap();
+  });
+  record("estimate", huffman_ratio, [&]() {
+    Huffman::CompressedSize(data.data(), size);
+  });
+  record("encode", huffman_ratio, [&]() {
+    BitString out;
+    huf.Encode(data.data(), size, &out);
+  });
+  record("decode", huffman_ratio, [&]() {
+    void* out = nullptr;
+    int64_t out_size = 0;
+    huf.Decode(bits, &out, &out_size);
+    delete[] reinterpret_cast<uint8_t*>(out);
+  });
+  record("serialize", 0, [&]() {
+    void* out = nullptr;
+    int64_t out_size = 0;
+    huf.Serialize(&out, &out_size);
+    delete[] reinterpret_cast<uint8_t*>(out);
+    bits.Serialize(&out, &out_size);
+    delete[] reinterpret_cast<uint8_t*>(out);
+  });
+  record("ans_table", 0, [&]() {
+    Ans table;
+    table.BuildTable(histogram);
+  });
+  record("ans_encode", ans_ratio, [&]() {
+    void* out = nullptr;
+    int64_t out_size = 0;
+    ans.Encode(data.data(), size, &out, &out_size);
+    delete[] reinterpret_cast<uint8_t*>(out);
+  });
+  record("ans_decode", ans_ratio, [&]() {
+    void* out = nullptr;
+    int64_t out_size = 0;
+    ans.Decode(ans_bits, ans_bits_size, &out, &out_size, size);
+    delete[] reinterpret_cast<uint8_t*>(out);
+  });
+  record("block_encode", block_ratio, [&]() {
+    void* out = nullptr;
+    int64_t out_size = 0;
+    compression::EncodeBlock(data.data(), size, &out, &out_size);
+    delete[] reinterpret_cast<uint8_t*>(out);
+  });
+  record("block_decode", block_ratio, [&]() {
+    void* out = nullptr;
+    int64_t out_size = 0;
+    compression::DecodeBlock(block, block_size, &out, &out_size);
+    delete[] reinterpret_cast<uint8_t*>(out);
+  });
+
+  delete[] reinterpret_cast<uint8_t*>(block);
+  delete[] reinterpret_cast<uint8_t*>(ans_bits);
+  return true;
+}
+
+void PrintTableHeader() {
+  cout << std::left << std::setw(8) << "corpus"
+       << std::right << std::setw(12) << "size"
+       << "  " << std::left << std::setw(14) << "stage"
+       << std::right << std::setw(10) << "MB/s"
+       << std::setw(10) << "ns/sym"
+       << std::setw(8) << "ratio"
+       << std::setw(10) << "allocs"
+       << std::setw(14) << "alloc bytes" << endl;
+}
+
+void PrintTable(const vector<Result>& results) {
+  for (auto it = results.cbegin(); it != results.cend(); ++it) {
+    cout << std::left << std::setw(8) << it->corpus
+         << std::right << std::setw(12) << it->size
+         << "  " << std::left << std::setw(14) << it->stage
+         << std::right << std::fixed
+         << std::setw(10) << std::setprecision(1) << MegabytesPerSecond(*it)
+         << std::setw(10) << std::setprecision(3) << NanosecondsPerSymbol(*it)
+         << std::setw(8) << std::setprecision(3) << it->ratio
+         << std::setw(10) << std::setprecision(1) << it->allocations
+         << std::setw(14) << std::setprecision(0) << it->allocated_bytes
+         << endl;
+  }
+}
+
+void PrintCsv(const vector<Result>& results) {
+  cout << "corpus,size,stage,iterations,ns_per_iteration,mb_per_s,"
+       << "ns_per_symbol,ratio,allocations,allocated_bytes" << endl;
+  for (auto it = results.cbegin(); it != results.cend(); ++it) {
+    cout << it->corpus << ',' << it->size << ',' << it->stage << ','
+         << it->iterations << ',' << it->ns_per_iteration << ','
+         << MegabytesPerSecond(*it) << ',' << NanosecondsPerSymbol(*it) << ','
+         << it->ratio << ',' << it->allocations << ','
+         << it->allocated_bytes << endl;
+  }
+}
+
+void PrintJson(const vector<Result>& results) {
+  cout << "[" << endl;
+  for (auto it = results.cbegin(); it != results.cend(); ++it) {
+    cout << "  {\"corpus\": \"" << it->corpus << "\", "
+         << "\"size\": " << it->size << ", "
+         << "\"stage\": \"" << it->stage << "\", "
+         << "\"iterations\": " << it->iterations << ", "
+         << "\"ns_per_iteration\": " << it->ns_per_iteration << ", "
+         << "\"mb_per_s\": " << MegabytesPerSecond(*it) << ", "
+         << "\"ns_per_symbol\": " << NanosecondsPerSymbol(*it) << ", "
+         << "\"ratio\": " << it->ratio << ", "
+         << "\"allocations\": " << it->allocations << ", "
+         << "\"allocated_bytes\": " << it->allocated_bytes << "}"
+         << (it + 1 == results.cend() ? "" : ",") << endl;
+  }
+  cout << "]" << endl;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (FLAGS_min_size <= 0 || FLAGS_max_size > kMaxCorpusSize ||
+      FLAGS_min_size > FLAGS_max_size || FLAGS_size_step < 2) {
+    cerr << "Sizes must satisfy 0 < min_size <= max_size <= 1 GiB, "
+         << "and size_step must be at least 2." << endl;
+    return 1;
+  }
+  if (FLAGS_format != "table" && FLAGS_format != "csv" &&
+      FLAGS_format != "json") {
+    cerr << "Unknown format: " << FLAGS_format << endl;
+    return 1;
+  }
+
+  vector<string> corpora = Split(FLAGS_corpora);
+  vector<string> stages = Split(FLAGS_stages);
+
+  vector<Result> results;
+  vector<uint8_t> data;
+  if (FLAGS_format == "table") {
+    PrintTableHeader();
+  }
+  for (auto corpus = corpora.cbegin(); corpus != corpora.cend(); ++corpus) {
+    for (int64_t size = FLAGS_min_size; size <= FLAGS_max_size;
+         size *= FLAGS_size_step) {
+      if (!Generate(*corpus, size, &data)) {
+        cerr << "Unknown corpus: " << *corpus << endl;
+        return 1;
+      }
+      if (!Run(*corpus, data, stages, &results)) {
+        cerr << "Round trip failed for " << *corpus << " of " << size
+             << " bytes." << endl;
+        return 1;
+      }
+      // Print progress as each size completes, unless the output is for
+      // a machine, in which case it is printed once at the end.
+      if (FLAGS_format == "table") {
+        PrintTable(results);
+        results.clear();
+      }
+    }
+  }
+
+  if (FLAGS_format == "csv") {
+    PrintCsv(results);
+  } else if (FLAGS_format == "json") {
+    PrintJson(results);
+  }
+  return 0;
+}
@@ -0,0 +1,186 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// Differential fuzz target for the Huffman class. The input is text; every
+// optimized way of coding it must produce exactly the bits which
+// |EncodeReference| does, and every way of decoding those bits must give
+// back the text. The block coder and the Ans class are checked for a round
+// trip on the same text. See "base/fuzz.h".
+//
+// The first byte of the input chooses options, and the rest is the text:
+//
+//   bits 0-4: the number of symbols, up to 20, to add with Fibonacci
+//             counts, which give codes as long as the number of symbols,
+//             and so exercise the slow paths of the kernels
+//   bits 5-7: the checkpoint interval, as a power of two
+
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <vector>
+
+#include "base/bitstring.h"
+#include "base/fuzz.h"
+#include "compression/ans/ans.h"
+#include "compression/block.h"
+#include "compression/huffman/huffman.h"
+
+using std::vector;
+
+using base::BitString;
+using compression::ans::Ans;
+using compression::huffman::Checkpoints;
+using compression::huffman::Huffman;
+
+namespace {
+bool SameBits(const BitString& lhs, const BitString& rhs) {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  for (uint64_t i = 0; i < lhs.size(); ++i) {
+    if (lhs.Get(i) != rhs.Get(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Compares |lhs| with the same number of bits at |rhs|, which are ordered
+// most significant bit first, as in a |BitString|.
+bool SameBits(const BitString& lhs, const uint8_t* rhs) {
+  for (uint64_t i = 0; i < lhs.size(); ++i) {
+    if (lhs.Get(i) != (((rhs[i / 8] << (i % 8)) & 0x80) != 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Decodes |bits| in every way the Huffman class offers, each of which must
+// give |text|.
+void CheckDecoders(const Huffman& huffman, const BitString& bits,
+                   const vector<uint8_t>& text, uint64_t interval,
+                   base::FuzzInput* input) {
+  vector<uint8_t> reference;
+  FUZZ_CHECK(huffman.DecodeReference(bits, &reference));
+  FUZZ_CHECK(reference == text);
+
+  void* decoded = nullptr;
+  int64_t decoded_size = -1;
+  FUZZ_CHECK(huffman.Decode(bits, &decoded, &decoded_size));
+  FUZZ_CHECK(decoded_size == static_cast<int64_t>(text.size()));
+  FUZZ_CHECK(text.empty() || memcmp(decoded, text.data(), text.size()) == 0);
+  delete[] reinterpret_cast<uint8_t*>(decoded);
+
+  vector<uint8_t> from;
+  FUZZ_CHECK(huffman.DecodeFrom(bits.data(), bits.size(), &from));
+  FUZZ_CHECK(from == text);
+
+  vector<uint8_t> into(text.size());
+  FUZZ_CHECK(huffman.DecodeInto(bits.data(), bits.size(), text.size(),
+                                into.data()));
+  FUZZ_CHECK(into == text);
+
+  Checkpoints checkpoints;
+  huffman.BuildCheckpoints(text.data(), static_cast<int64_t>(text.size()),
+                           interval, &checkpoints);
+  uint64_t first = input->Below(text.size() + 1);
+  uint64_t count = input->Below(text.size() - first + 1);
+  vector<uint8_t> range;
+  FUZZ_CHECK(huffman.DecodeRange(bits, checkpoints, first, count, &range));
+  FUZZ_CHECK(range == vector<uint8_t>(text.data() + first,
+                                      text.data() + first + count));
+}
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  base::FuzzInput input(data, size);
+  uint8_t options = input.Byte();
+  size_t text_size;
+  const uint8_t* text_bytes = input.Rest(&text_size);
+  vector<uint8_t> text(text_bytes, text_bytes + text_size);
+
+  int fibonacci_symbols = (options & 0x1F) % 21;
+  uint64_t previous = 1;
+  uint64_t current = 1;
+  for (int i = 0; i < fibonacci_symbols; ++i) {
+    text.insert(text.end(), current, static_cast<uint8_t>('A' + i));
+    uint64_t next = previous + current;
+    previous = current;
+    current = next;
+  }
+  uint64_t interval = uint64_t{1} << (options >> 5);
+  int64_t length = static_cast<int64_t>(text.size());
+
+  // The rest of the input is used again to choose the ranges to decode.
+  base::FuzzInput choices(text_bytes, text_size);
+
+  Huffman huffman;
+  huffman.BuildTree(text.data(), length);
+  BitString reference;
+  huffman.EncodeReference(text.data(), length, &reference);
+
+  vector<uint64_t> histogram;
+  Huffman::BuildHistogram(text.data(), length, &histogram);
+  FUZZ_CHECK(huffman.CodedBits(histogram) == reference.size());
+  FUZZ_CHECK(huffman.CountBits(text.data(), length) == reference.size());
+
+  BitString bits;
+  huffman.Encode(text.data(), length, &bits);
+  FUZZ_CHECK(SameBits(bits, reference));
+
+  // The output is exactly as long as the bits need, so that ASan catches
+  // any write past it.
+  vector<uint8_t> into((reference.size() + 7) / 8, 0);
+  huffman.EncodeInto(text.data(), length, into.data());
+  FUZZ_CHECK(SameBits(reference, into.data()));
+
+  CheckDecoders(huffman, reference, text, interval, &choices);
+
+  // The tables built by |BuildMap| change how each function runs, but not
+  // what it produces.
+  huffman.BuildMap();
+  huffman.Encode(text.data(), length, &bits);
+  FUZZ_CHECK(SameBits(bits, reference));
+  std::fill(into.begin(), into.end(), 0);
+  huffman.EncodeInto(text.data(), length, into.data());
+  FUZZ_CHECK(SameBits(reference, into.data()));
+  CheckDecoders(huffman, reference, text, interval, &choices);
+
+  // A tree rebuilt from the serialized histogram is the same tree.
+  void* header = nullptr;
+  int64_t header_size = -1;
+  huffman.Serialize(&header, &header_size);
+  Huffman other;
+  FUZZ_CHECK(other.Unserialize(header, header_size));
+  delete[] reinterpret_cast<uint8_t*>(header);
+  BitString other_bits;
+  other.EncodeReference(text.data(), length, &other_bits);
+  FUZZ_CHECK(SameBits(other_bits, reference));
+  CheckDecoders(other, reference, text, interval, &choices);
+
+  void* block = nullptr;
+  int64_t block_size = -1;
+  compression::EncodeBlock(text.data(), length, &block, &block_size);
+  void* decoded = nullptr;
+  int64_t decoded_size = -1;
+  FUZZ_CHECK(compression::DecodeBlock(block, block_size, &decoded,
+                                      &decoded_size));
+  FUZZ_CHECK(decoded_size == static_cast<int64_t>(text.size()));
+  FUZZ_CHECK(text.empty() || memcmp(decoded, text.data(), text.size()) == 0);
+  delete[] reinterpret_cast<uint8_t*>(block);
+  delete[] reinterpret_cast<uint8_t*>(decoded);
+
+  Ans ans;
+  ans.BuildTable(text.data(), length);
+  void* coded = nullptr;
+  int64_t coded_size = -1;
+  ans.Encode(text.data(), length, &coded, &coded_size);
+  FUZZ_CHECK(ans.Decode(coded, coded_size, &decoded, &decoded_size, length));
+  FUZZ_CHECK(decoded_size == static_cast<int64_t>(text.size()));
+  FUZZ_CHECK(text.empty() || memcmp(decoded, text.data(), text.size()) == 0);
+  delete[] reinterpret_cast<uint8_t*>(coded);
+  delete[] reinterpret_cast<uint8_t*>(decoded);
+  return 0;
+}
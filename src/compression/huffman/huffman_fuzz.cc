@@ -0,0 +1,124 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// Fuzz target for decoding untrusted input with the Huffman class. The
+// input is split into a serialized histogram and the bits to decode, and
+// every optimized decoder must agree with |DecodeReference| on them,
+// whether or not they are well-formed. See "base/fuzz.h".
+//
+// The input is laid out as:
+//
+//   [uint8 mode][uint16 header size][header][uint8 unused bits][bits]
+//
+// where |unused bits| gives the number of bits at the end of the last byte
+// which are not part of the code. Random headers are nearly all rejected,
+// so if |mode| is odd, |header| is instead text from which a tree is built
+// and serialized, and it is the bits alone which are hostile. The bits are
+// also given to |base::BitString::Unserialize|, which must reject them or
+// agree with the size it is given.
+
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <vector>
+
+#include "base/bitstring.h"
+#include "base/fuzz.h"
+#include "compression/histogram.h"
+#include "compression/huffman/huffman.h"
+
+using std::vector;
+
+using base::BitString;
+using compression::huffman::Huffman;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  base::FuzzInput input(data, size);
+  bool build = input.Byte() % 2 == 1;
+  size_t header_size = input.Integer<uint16_t>();
+  size_t available = input.remaining();
+  header_size = (header_size < available) ? header_size : available;
+  vector<uint8_t> header(header_size);
+  for (auto& c : header) {
+    c = input.Byte();
+  }
+  uint64_t unused_bits = input.Byte() % 8;
+  size_t bytes_size;
+  const uint8_t* bytes = input.Rest(&bytes_size);
+
+  BitString serialized;
+  if (serialized.Unserialize(bytes, static_cast<int64_t>(bytes_size))) {
+    FUZZ_CHECK(serialized.size() <= 8 * bytes_size);
+  }
+
+  Huffman huffman;
+  if (build) {
+    huffman.BuildTree(header.data(), static_cast<int64_t>(header.size()));
+    void* built = nullptr;
+    int64_t built_size = -1;
+    huffman.Serialize(&built, &built_size);
+    const uint8_t* built_bytes = reinterpret_cast<const uint8_t*>(built);
+    header.assign(built_bytes, built_bytes + built_size);
+    delete[] built_bytes;
+  }
+  if (!huffman.Unserialize(header.data(),
+                           static_cast<int64_t>(header.size()))) {
+    FUZZ_CHECK(!build);
+    return 0;
+  }
+
+  // Every accepted header is canonical, so |Serialize| reproduces it.
+  void* reserialized = nullptr;
+  int64_t reserialized_size = -1;
+  huffman.Serialize(&reserialized, &reserialized_size);
+  FUZZ_CHECK(reserialized_size == huffman.SerializedSize());
+  FUZZ_CHECK(reserialized_size ==
+             compression::SerializedHistogramSize(header.data()));
+  FUZZ_CHECK(memcmp(reserialized, header.data(),
+                    static_cast<size_t>(reserialized_size)) == 0);
+  delete[] reinterpret_cast<uint8_t*>(reserialized);
+
+  BitString bits;
+  uint64_t num_bits = 8 * bytes_size;
+  num_bits -= std::min(num_bits, unused_bits);
+  bits.resize(num_bits);
+  if (bytes_size > 0) {
+    memcpy(bits.data(), bytes, bytes_size);
+  }
+
+  vector<uint8_t> reference;
+  bool reference_ok = huffman.DecodeReference(bits, &reference);
+
+  vector<uint8_t> from;
+  bool from_ok = huffman.DecodeFrom(bits.data(), bits.size(), &from);
+  FUZZ_CHECK(from_ok == reference_ok);
+  FUZZ_CHECK(!reference_ok || from == reference);
+
+  // |Decode| insists on exactly the number of symbols in the histogram.
+  void* decoded = nullptr;
+  int64_t decoded_size = -1;
+  bool decode_ok = huffman.Decode(bits, &decoded, &decoded_size);
+  FUZZ_CHECK(decode_ok ==
+             (reference_ok && reference.size() == huffman.symbol_count()));
+  FUZZ_CHECK(!decode_ok ||
+             (decoded_size == static_cast<int64_t>(reference.size()) &&
+              std::equal(reference.begin(), reference.end(),
+                         reinterpret_cast<uint8_t*>(decoded))));
+  delete[] reinterpret_cast<uint8_t*>(decoded);
+
+  if (reference_ok) {
+    // One byte more than is needed, so that overruns are caught.
+    vector<uint8_t> into(reference.size() + 1);
+    FUZZ_CHECK(huffman.DecodeInto(bits.data(), bits.size(),
+                                  reference.size(), into.data()));
+    FUZZ_CHECK(std::equal(reference.begin(), reference.end(), into.begin()));
+    FUZZ_CHECK(!huffman.DecodeInto(bits.data(), bits.size(),
+                                   reference.size() + 1, into.data()));
+    if (!reference.empty()) {
+      FUZZ_CHECK(!huffman.DecodeInto(bits.data(), bits.size(),
+                                     reference.size() - 1, into.data()));
+    }
+  }
+  return 0;
+}
@@ -5,10 +5,14 @@
 // Assumes BitString class is sane
 
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <vector>
 
 #include <base/bitstring.h>
 #include <compression/huffman/huffman.h>
@@ -34,7 +38,7 @@ int main(int argc, char** argv) {
   /////////////////////////////////////////////////////////////////////////////
   // Encode and Decode, compare results
   Huffman huf;
-  huf.BuildTree(str.c_str(), str.size());
+  huf.BuildTree(str);
   huf.BuildMap();
 
   BitString bits;
@@ -47,7 +51,7 @@ int main(int argc, char** argv) {
   cout << "==========TESTING DATA FIDELITY==========" << endl;
   cout << "Decoding . . ." << endl;
 
-  int size = -1;
+  int64_t size = -1;
   char* decoded = nullptr;
   if (huf.Decode(bits, reinterpret_cast<void**>(&decoded), &size)) {
     cout << "BitString sane" << endl;
@@ -66,7 +70,7 @@ int main(int argc, char** argv) {
   // Serialize and Unserialize, compare results
   // TODO: direct comparison of histograms
   void* buffer;
-  int serial_size;
+  int64_t serial_size;
   huf.Serialize(&buffer, &serial_size);
 
   cout << "Serialized to " << serial_size << " bytes" << endl;
@@ -91,6 +95,182 @@ int main(int argc, char** argv) {
   cout << "Decoded to:\n\n" << tmp << endl;
   cout << "Fidelity: " << (tmp == str) << endl;
 
+  /////////////////////////////////////////////////////////////////////////////
+  // Histograms too large for the 32-bit serialized form are scaled
+  cout << "==========TESTING SCALED HISTOGRAM==========" << endl;
+  std::vector<uint64_t> histogram(base::kMaxByte, 0);
+  histogram['a'] = 5000000000;
+  histogram['b'] = 3000000000;
+  histogram['c'] = 1;
+
+  Huffman huf3;
+  huf3.BuildTree(histogram);
+  huf3.Serialize(&buffer, &serial_size);
+
+  Huffman huf4;
+  huf4.Unserialize(buffer, serial_size);
+  delete[] reinterpret_cast<uint8_t*>(buffer);
+
+  cout << "Serialized to " << serial_size << " bytes" << endl;
+  cout << "Symbol count: " << huf4.symbol_count() << endl;
+  cout << "Fidelity: " << (huf3.symbol_count() == huf4.symbol_count() &&
+                           huf3.ToString() == huf4.ToString()) << endl;
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Sizes computed without coding must match those of the coded output
+  cout << "==========TESTING SIZE ESTIMATE==========" << endl;
+  huf.Serialize(&buffer, &serial_size);
+  delete[] reinterpret_cast<uint8_t*>(buffer);
+  bits.Serialize(&buffer, &size);
+  delete[] reinterpret_cast<uint8_t*>(buffer);
+
+  int64_t str_size = static_cast<int64_t>(str.size()) + 1;
+  int64_t compressed_size = Huffman::CompressedSize(str.c_str(), str_size);
+  int64_t sampled_size = Huffman::EstimateCompressedSize(
+      str.c_str(), str_size, static_cast<int64_t>(str.size() / 4));
+  cout << "Compressed size: " << compressed_size << endl;
+  cout << "Estimated from a quarter: " << sampled_size << endl;
+  cout << "Fidelity: " << (huf.SerializedSize() == serial_size &&
+                           compressed_size == serial_size + size &&
+                           Huffman::EstimateCompressedSize(
+                               str.c_str(), str_size, str_size) ==
+                           compressed_size) << endl;
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Ranges decoded from checkpoints must match the same range of the text
+  cout << "==========TESTING RANDOM ACCESS==========" << endl;
+  compression::huffman::Checkpoints checkpoints;
+  huf.BuildCheckpoints(str.c_str(), str_size, 16, &checkpoints);
+  cout << "Checkpoints: " << checkpoints.offsets.size() << endl;
+
+  bool ranges_sane = true;
+  std::vector<uint8_t> range;
+  for (uint64_t first = 0; first <= str.size(); first += 7) {
+    for (uint64_t count : {uint64_t{1}, uint64_t{5}, uint64_t{40}}) {
+      count = std::min<uint64_t>(count, str.size() + 1 - first);
+      ranges_sane &= huf.DecodeRange(bits, checkpoints, first, count, &range);
+      ranges_sane &= (string(range.begin(), range.end()) ==
+                      string(str.c_str() + first, count));
+    }
+  }
+  ranges_sane &= !huf.DecodeRange(bits, checkpoints, str.size(), 2, &range);
+  cout << "Fidelity: " << ranges_sane << endl;
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Coding in pairs must produce the same bits as coding one at a time
+  cout << "==========TESTING PAIR TABLE==========" << endl;
+  bool pairs_sane = true;
+  for (int skew : {1, 2, 4}) {
+    // Each symbol is |skew| times as likely as the next, so that strong
+    // skews give codes too long for some pairs to fit the table.
+    std::vector<uint8_t> text;
+    for (int symbol = 0; symbol < 40; ++symbol) {
+      uint64_t copies = (uint64_t{1} << 20) >> std::min(symbol * (skew - 1),
+                                                        20);
+      text.insert(text.end(), std::max<uint64_t>(copies, 1), symbol);
+    }
+    for (size_t i = text.size() - 1; i > 0; --i) {
+      std::swap(text[i], text[static_cast<size_t>(rand()) % (i + 1)]);
+    }
+    text.resize(text.size() - static_cast<size_t>(rand() % 7));
+    int64_t text_size = static_cast<int64_t>(text.size());
+
+    Huffman single;
+    single.BuildTree(text.data(), text_size);
+    Huffman paired;
+    paired.BuildTree(text.data(), text_size);
+    paired.BuildMap();
+
+    BitString single_bits;
+    BitString paired_bits;
+    single.Encode(text.data(), text_size, &single_bits);
+    paired.Encode(text.data(), text_size, &paired_bits);
+    bool same = single_bits.size() == paired_bits.size() &&
+        memcmp(single_bits.data(), paired_bits.data(),
+               (single_bits.size() + 7) / 8) == 0;
+    cout << "Longest code " << paired.max_code_length() << ": " << same
+         << endl;
+    pairs_sane &= same;
+  }
+
+  // Fibonacci counts give codes as long as there are symbols, longer than
+  // the bits a word holds besides a full group of pairs. Codes that long
+  // are rare, so the text is not drawn from the histogram but repeats a
+  // pattern which puts one after two pairs.
+  std::vector<uint64_t> fibonacci(base::kMaxByte, 0);
+  fibonacci[0] = 1;
+  fibonacci[1] = 1;
+  for (size_t symbol = 2; symbol < 40; ++symbol) {
+    fibonacci[symbol] = fibonacci[symbol - 1] + fibonacci[symbol - 2];
+  }
+  std::vector<uint8_t> text;
+  for (int i = 0; i < 1000; ++i) {
+    text.insert(text.end(), {28, 28, 0, 38});
+  }
+  Huffman skewed;
+  skewed.BuildTree(fibonacci);
+  skewed.BuildMap();
+  BitString reference_bits;
+  BitString skewed_bits;
+  int64_t text_size = static_cast<int64_t>(text.size());
+  skewed.EncodeReference(text.data(), text_size, &reference_bits);
+  skewed.Encode(text.data(), text_size, &skewed_bits);
+  std::vector<uint8_t> skewed_text;
+  bool same = reference_bits.size() == skewed_bits.size() &&
+      memcmp(reference_bits.data(), skewed_bits.data(),
+             (reference_bits.size() + 7) / 8) == 0 &&
+      skewed.DecodeFrom(skewed_bits.data(), skewed_bits.size(),
+                        &skewed_text) &&
+      skewed_text == text;
+  cout << "Longest code " << skewed.max_code_length() << ": " << same
+       << endl;
+  pairs_sane &= same;
+  cout << "Fidelity: " << pairs_sane << endl;
+
+  /////////////////////////////////////////////////////////////////////////////
+  // Each decode table width must decode what was encoded, as must codes
+  // longer than the widest table, which fall back to walking the tree
+  cout << "==========TESTING DECODE TABLES==========" << endl;
+  bool tables_sane = true;
+  // The first four select each table width, and the last is too long for
+  // the widest.
+  for (int longest : {8, 10, 11, 12, 16}) {
+    // Fibonacci counts over one more symbol than the longest code give
+    // codes of every length up to it.
+    std::vector<uint8_t> sample;
+    uint64_t count = 1;
+    uint64_t next = 1;
+    for (int symbol = 0; symbol <= longest; ++symbol) {
+      sample.insert(sample.end(), 3 * count, static_cast<uint8_t>(symbol));
+      next += count;
+      count = next - count;
+    }
+    for (size_t i = sample.size() - 1; i > 0; --i) {
+      std::swap(sample[i], sample[static_cast<size_t>(rand()) % (i + 1)]);
+    }
+    int64_t sample_size = static_cast<int64_t>(sample.size());
+
+    Huffman table;
+    table.BuildTree(sample.data(), sample_size);
+    BitString table_bits;
+    table.Encode(sample.data(), sample_size, &table_bits);
+
+    uint8_t* fixed = nullptr;
+    int64_t fixed_size = -1;
+    std::vector<uint8_t> grown;
+    bool sane = table.max_code_length() == longest &&
+        table.Decode(table_bits, reinterpret_cast<void**>(&fixed),
+                     &fixed_size) &&
+        fixed_size == sample_size &&
+        std::equal(sample.begin(), sample.end(), fixed) &&
+        table.DecodeFrom(table_bits.data(), table_bits.size(), &grown) &&
+        grown == sample;
+    delete[] fixed;
+    cout << "Longest code " << table.max_code_length() << ": " << sane
+         << endl;
+    tables_sane &= sane;
+  }
+  cout << "Fidelity: " << tables_sane << endl;
 
   return 0;
 }
@@ -0,0 +1,415 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// These are the inner loops of Huffman encoding and decoding. They are
+// templated on the parameters which would otherwise be loop bounds, so that
+// each instantiation is fully unrolled with constants. |Huffman| selects an
+// instantiation from the maximum code length when the tree is built.
+//
+// Codes are stored most significant bit first, matching the bit order of
+// |base::BitString|.
+
+#ifndef HUFFMAN_KERNELS_H_
+#define HUFFMAN_KERNELS_H_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+#include "compression/huffman/node.h"
+
+namespace compression {
+namespace huffman {
+namespace kernels {
+// The number of bits which a refill of |BitReader| guarantees are buffered.
+static constexpr int kRefillBits = 56;
+
+// A decode table maps every |kTableBits|-bit prefix of the input to the
+// symbol whose code begins it. Each entry holds the symbol in its low byte
+// and the length of its code in its high byte. A length of |0| indicates
+// that the code is longer than the table, and the tree must be walked.
+inline uint16_t MakeEntry(uint8_t symbol, int length) {
+  return static_cast<uint16_t>(symbol | (length << 8));
+}
+
+// Reads eight bytes as a big-endian integer, so that the first bit of the
+// stream is the most significant bit of the result.
+inline uint64_t LoadBigEndian(const uint8_t* bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; ++i) {
+    value = (value << 8) | bytes[i];
+  }
+  return value;
+}
+
+// Buffers up to 64 bits of a bitstring, left-aligned in a word.
+class BitReader {
+ public:
+  BitReader(const uint8_t* data, uint64_t num_bits)
+      : data_(data), num_bits_(num_bits),
+        num_bytes_((num_bits + 7) / 8) {}
+
+  // A fast refill reads a whole word, so at least eight bytes must remain.
+  bool can_refill_fast() const {
+    return position_ + 8 <= num_bytes_;
+  }
+
+  // Tops up the buffer to at least |kRefillBits| bits without branching.
+  // Bits of a partially-consumed byte may be loaded twice; since they are
+  // loaded into the same place both times, OR-ing them in is harmless.
+  void RefillFast() {
+    buffer_ |= LoadBigEndian(data_ + position_) >> count_;
+    int bytes = (63 - count_) >> 3;
+    position_ += static_cast<uint64_t>(bytes);
+    count_ += bytes << 3;
+  }
+
+  // Tops up the buffer one byte at a time, stopping at the end of the data.
+  void RefillSafe() {
+    while (count_ <= kRefillBits && position_ < num_bytes_) {
+      buffer_ |= static_cast<uint64_t>(data_[position_++]) <<
+          (kRefillBits - count_);
+      count_ += 8;
+    }
+  }
+
+  uint64_t Peek(int bits) const {
+    return buffer_ >> (64 - bits);
+  }
+
+  void Consume(int bits) {
+    buffer_ <<= bits;
+    count_ -= bits;
+    consumed_ += static_cast<uint64_t>(bits);
+  }
+
+  int count() const {
+    return count_;
+  }
+
+  uint64_t remaining() const {
+    return num_bits_ - consumed_;
+  }
+
+ private:
+  const uint8_t* data_;
+  uint64_t num_bits_;
+  uint64_t num_bytes_;
+
+  uint64_t position_ = 0;  // The next byte to be loaded
+  uint64_t consumed_ = 0;  // The number of bits consumed so far
+  uint64_t buffer_ = 0;
+  int count_ = 0;          // The number of valid bits in |buffer_|
+};
+
+// An output is given each decoded symbol by |Put|. Decoding stops early
+// once it is |done|, and no more than |room| symbols are put into it.
+
+// An output which grows to fit the decoded symbols.
+class VectorOutput {
+ public:
+  explicit VectorOutput(std::vector<uint8_t>* symbols) : symbols_(symbols) {}
+
+  void Put(uint8_t symbol) {
+    symbols_->push_back(symbol);
+  }
+
+  bool done() const {
+    return false;
+  }
+
+  uint64_t room() const {
+    return UINT64_MAX;
+  }
+
+ private:
+  std::vector<uint8_t>* symbols_;
+};
+
+// An output which discards the first |skip| symbols, keeps the |count|
+// which follow them, and is then done. The decoder may put a few symbols
+// after it is done; they are discarded too.
+class RangeOutput {
+ public:
+  RangeOutput(uint64_t skip, uint64_t count, std::vector<uint8_t>* symbols)
+      : skip_(skip), end_(skip + count), symbols_(symbols) {}
+
+  void Put(uint8_t symbol) {
+    if (index_ >= skip_ && index_ < end_) {
+      symbols_->push_back(symbol);
+    }
+    ++index_;
+  }
+
+  bool done() const {
+    return index_ >= end_;
+  }
+
+  uint64_t room() const {
+    return UINT64_MAX;
+  }
+
+ private:
+  uint64_t skip_;
+  uint64_t end_;
+  uint64_t index_ = 0;
+  std::vector<uint8_t>* symbols_;
+};
+
+// An output of a known number of symbols, written to a buffer allocated
+// ahead of time. |Put| does no checking of its own; the decoder checks
+// |room| once for each refill, and before each symbol of the tail.
+class FixedOutput {
+ public:
+  FixedOutput(uint8_t* symbols, uint64_t count)
+      : next_(symbols), end_(symbols + count) {}
+
+  void Put(uint8_t symbol) {
+    *next_++ = symbol;
+  }
+
+  bool done() const {
+    return false;
+  }
+
+  uint64_t room() const {
+    return static_cast<uint64_t>(end_ - next_);
+  }
+
+ private:
+  uint8_t* next_;
+  uint8_t* end_;
+};
+
+// Decodes a code which is too long for the table by walking the tree one
+// bit at a time. Returns false if the bits run out before reaching a leaf.
+template <typename Output>
+bool DecodeLong(const Node* root, BitReader* reader, Output* out) {
+  const Node* node = root;
+  while (!node->is_leaf()) {
+    if (reader->remaining() == 0) {
+      return false;
+    }
+    if (reader->count() == 0) {
+      reader->RefillSafe();
+    }
+    node = reader->Peek(1) ? node->get_right() : node->get_left();
+    reader->Consume(1);
+  }
+  out->Put(node->get_symbol());
+  return true;
+}
+
+// Decodes |num_bits| bits of |data| using |table|, which has
+// |1 << kTableBits| entries, beginning |first_bit| bits into the first byte.
+// Decoding stops early once |out| is done. Returns true if and only if the
+// bits end on a symbol boundary, or decoding stopped early. Bits left over
+// once |out| has no more room are an error.
+template <int kTableBits, typename Output>
+bool Decode(const uint16_t* table, const Node* root,
+            const uint8_t* data, uint64_t num_bits, int first_bit,
+            Output* out) {
+  // Each refill buffers enough bits for this many table lookups.
+  constexpr int kSymbolsPerRefill = kRefillBits / kTableBits;
+
+  assert(first_bit >= 0 && first_bit < 8);
+  BitReader reader(data, num_bits);
+  if (first_bit > 0) {
+    reader.RefillSafe();
+    reader.Consume(first_bit);
+  }
+
+  // While a whole refill remains, and there is room for every symbol it
+  // can hold, no lookup can run past the end of the bits and no symbol past
+  // the end of the output, so the inner loop needs no bounds checks.
+  while (!out->done() && reader.remaining() >= kRefillBits &&
+         reader.can_refill_fast() && out->room() >= kSymbolsPerRefill) {
+    reader.RefillFast();
+    for (int i = 0; i < kSymbolsPerRefill; ++i) {
+      uint16_t entry = table[reader.Peek(kTableBits)];
+      int length = entry >> 8;
+      if (length == 0) {
+        if (!DecodeLong(root, &reader, out)) {
+          return false;
+        }
+        break;
+      }
+      out->Put(static_cast<uint8_t>(entry));
+      reader.Consume(length);
+    }
+  }
+
+  // The tail is decoded one symbol at a time, checking each code against
+  // the number of bits which remain.
+  while (!out->done() && reader.remaining() > 0) {
+    if (out->room() == 0) {
+      return false;
+    }
+    reader.RefillSafe();
+    uint16_t entry = table[reader.Peek(kTableBits)];
+    uint64_t length = entry >> 8;
+    if (length == 0) {
+      if (!DecodeLong(root, &reader, out)) {
+        return false;
+      }
+      continue;
+    }
+    if (length > reader.remaining()) {
+      return false;
+    }
+    out->Put(static_cast<uint8_t>(entry));
+    reader.Consume(length);
+  }
+  return true;
+}
+
+// Writes the whole bytes among the |*count| low bits of |acc|, one at a
+// time, leaving fewer than eight bits.
+inline void FlushBytes(uint64_t acc, int* count, uint8_t** out) {
+  while (*count >= 8) {
+    *count -= 8;
+    *(*out)++ = static_cast<uint8_t>(acc >> *count);
+  }
+}
+
+// Codes the symbols from |i| to |size| one at a time, and then pads the
+// final partial byte with zero bits.
+inline void EncodeTail(const uint64_t* codes, const uint8_t* lengths,
+                       const uint8_t* in, size_t i, size_t size,
+                       uint64_t acc, int count, uint8_t* out) {
+  for (; i < size; ++i) {
+    uint8_t symbol = in[i];
+    acc = (acc << lengths[symbol]) | codes[symbol];
+    count += lengths[symbol];
+    FlushBytes(acc, &count, &out);
+  }
+
+  if (count > 0) {
+    *out = static_cast<uint8_t>(acc << (8 - count));
+  }
+}
+
+// Encodes the |size| bytes at |in| into |out|, which must be large enough
+// to hold every code. Codes are accumulated right-aligned in a word, and
+// whole bytes are flushed after every |kSymbolsPerFlush| symbols. Fewer than
+// eight bits remain after a flush, so the caller must choose
+// |kSymbolsPerFlush| such that that many codes fit in the other 56.
+template <int kSymbolsPerFlush>
+void Encode(const uint64_t* codes, const uint8_t* lengths,
+            const uint8_t* in, size_t size, uint8_t* out) {
+  uint64_t acc = 0;
+  int count = 0;
+
+  size_t i = 0;
+  for (; size - i >= kSymbolsPerFlush; i += kSymbolsPerFlush) {
+    for (size_t j = 0; j < kSymbolsPerFlush; ++j) {
+      uint8_t symbol = in[i + j];
+      acc = (acc << lengths[symbol]) | codes[symbol];
+      count += lengths[symbol];
+    }
+    FlushBytes(acc, &count, &out);
+  }
+  EncodeTail(codes, lengths, in, i, size, acc, count, out);
+}
+
+// Writes |value| as eight big-endian bytes, the inverse of |LoadBigEndian|.
+// It is written out in full so that compilers merge it into a single
+// byte-swapped store, which they do not do for the equivalent loop.
+inline void StoreBigEndian(uint64_t value, uint8_t* bytes) {
+  bytes[0] = static_cast<uint8_t>(value >> 56);
+  bytes[1] = static_cast<uint8_t>(value >> 48);
+  bytes[2] = static_cast<uint8_t>(value >> 40);
+  bytes[3] = static_cast<uint8_t>(value >> 32);
+  bytes[4] = static_cast<uint8_t>(value >> 24);
+  bytes[5] = static_cast<uint8_t>(value >> 16);
+  bytes[6] = static_cast<uint8_t>(value >> 8);
+  bytes[7] = static_cast<uint8_t>(value);
+}
+
+// Every code is at least one bit long, so once this many symbols remain to
+// be coded, at least eight more bytes of output will follow. Until then
+// |EncodePairs| may write a whole word at a time, to be completed or
+// overwritten by the bytes which follow it.
+static constexpr int kWordSlackSymbols = 64;
+
+// A pair table maps every pair of symbols to their two codes, concatenated.
+// It is indexed by the first symbol in the high byte and the second in the
+// low byte. Each entry holds the codes right-aligned above the low
+// |kPairLengthBits| bits, which hold their total length.
+//
+// Pairs whose codes total more than |kMaxPairLength| bits are left at |0|,
+// and are coded one symbol at a time. Such pairs include a rare symbol, so
+// they are rare themselves.
+static constexpr int kPairLengthBits = 5;
+static constexpr int kMaxPairLength = 24;
+
+inline uint32_t MakePairEntry(uint64_t code, int length) {
+  return static_cast<uint32_t>((code << kPairLengthBits) |
+                               static_cast<uint64_t>(length));
+}
+
+// Writes the whole bytes among the |*count| high bits of |*acc| with a
+// single store, leaving fewer than eight bits at the top of |*acc|.
+inline void FlushLeft(uint64_t* acc, int* count, uint8_t** out) {
+  StoreBigEndian(*acc, *out);
+  *out += *count >> 3;
+  *acc <<= *count & ~7;
+  *count &= 7;
+}
+
+// As |Encode|, but codes two symbols with each lookup into |pairs|. Whole
+// bytes are flushed after every |kPairsPerFlush| pairs, so the caller must
+// choose |kPairsPerFlush| such that that many pairs from the table fit in
+// 56 bits.
+//
+// Codes are accumulated left-aligned instead, so that each is placed by a
+// shift computed from the count alone, rather than by shifting everything
+// before it. Only the count and an OR then carry from one pair to the
+// next. Several bytes are written by nearly every flush, so a single store
+// is cheaper than a loop.
+template <int kPairsPerFlush>
+void EncodePairs(const uint32_t* pairs, const uint64_t* codes,
+                 const uint8_t* lengths, const uint8_t* in, size_t size,
+                 uint8_t* out) {
+  constexpr size_t kSymbolsPerFlush = 2 * kPairsPerFlush;
+  constexpr uint32_t kLengthMask = (1 << kPairLengthBits) - 1;
+
+  uint64_t acc = 0;
+  int count = 0;
+
+  size_t i = 0;
+  for (; size - i >= kSymbolsPerFlush + kWordSlackSymbols;
+       i += kSymbolsPerFlush) {
+    for (size_t j = 0; j < kSymbolsPerFlush; j += 2) {
+      uint32_t entry = pairs[(in[i + j] << 8) | in[i + j + 1]];
+      int length = entry & kLengthMask;
+      if (length == 0) {
+        // Flushing before each code leaves room in the word for any code,
+        // however long, and flushing after the last keeps the count within
+        // the bounds assumed for the rest of the pairs.
+        FlushLeft(&acc, &count, &out);
+        for (size_t k = 0; k < 2; ++k) {
+          uint8_t symbol = in[i + j + k];
+          count += lengths[symbol];
+          acc |= codes[symbol] << (64 - count);
+          FlushLeft(&acc, &count, &out);
+        }
+        continue;
+      }
+      count += length;
+      acc |= static_cast<uint64_t>(entry >> kPairLengthBits) << (64 - count);
+    }
+    FlushLeft(&acc, &count, &out);
+  }
+
+  // The tail expects the remaining bits right-aligned.
+  acc = count == 0 ? 0 : acc >> (64 - count);
+  EncodeTail(codes, lengths, in, i, size, acc, count, out);
+}
+}  // namespace kernels
+}  // namespace huffman
+}  // namespace compression
+
+#endif  // HUFFMAN_KERNELS_H_
@@ -21,7 +21,7 @@ class Node {
 
   // Since frequency is at least |0|, |-1| serves to
   // indicate no valid frequency has been given yet.
-  constexpr static int kDummyFrequency = -1;
+  constexpr static int64_t kDummyFrequency = -1;
 
   //////////////////////////////////////////////////////////////////////////////
   // Factory Functions
@@ -37,7 +37,7 @@ class Node {
 
   // This builds a leaf node, which shall have a symbol but no children.
   // It returns a pointer to the constructed Node.
-  static Node* BuildLeaf(uint8_t symbol, int frequency) {
+  static Node* BuildLeaf(uint8_t symbol, int64_t frequency) {
     Node* res = new Node();
     res->InitLeaf(symbol, frequency);
     return res;
@@ -69,7 +69,7 @@ class Node {
     return symbol_;
   }
 
-  int get_frequency() const {
+  int64_t get_frequency() const {
     return frequency_;
   }
 
@@ -82,7 +82,7 @@ class Node {
   
   // A Node contains a symbol if and only if it is a leaf Node.
   // A Leaf Node by definition must have no children.
-  bool InitLeaf(uint8_t symbol, int frequency) {
+  bool InitLeaf(uint8_t symbol, int64_t frequency) {
     symbol_ = symbol;
     frequency_ = frequency;
     return true;
@@ -90,7 +90,7 @@ class Node {
 
   // If a Node is not a leaf node, the symbol is left at the default
   // All other values are used.
-  bool Init(Node* left, Node* right, int frequency) {
+  bool Init(Node* left, Node* right, int64_t frequency) {
     left_ = left;
     right_ = right;
     frequency_ = frequency;
@@ -98,7 +98,7 @@ class Node {
   }
   
   uint8_t symbol_ = kDummySymbol;
-  int frequency_ = kDummyFrequency;
+  int64_t frequency_ = kDummyFrequency;
 
   Node* left_ = nullptr;
   Node* right_ = nullptr;
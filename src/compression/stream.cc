@@ -0,0 +1,153 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+
+#include "compression/stream.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <vector>
+
+#include "compression/block.h"
+
+using std::vector;
+
+namespace compression {
+namespace {
+// Moves any unpulled output to the front of |output|, so that the space
+// already pulled can be reused.
+void Compact(vector<uint8_t>* output, int64_t* position) {
+  output->erase(output->begin(), output->begin() + *position);
+  *position = 0;
+}
+
+int64_t Drain(const vector<uint8_t>& output, int64_t* position,
+              void* buffer, int64_t capacity) {
+  int64_t size = std::min<int64_t>(
+      capacity, static_cast<int64_t>(output.size()) - *position);
+  if (size <= 0) {
+    return 0;
+  }
+  memcpy(buffer, output.data() + *position, static_cast<size_t>(size));
+  *position += size;
+  return size;
+}
+}  // namespace
+
+HuffmanEncoderStream::HuffmanEncoderStream(int64_t block_size)
+    : block_size_(std::max<int64_t>(block_size, 1)) {
+  input_.reserve(static_cast<size_t>(block_size_));
+}
+
+int64_t HuffmanEncoderStream::Push(const void* data, int64_t size) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+
+  int64_t consumed = 0;
+  while (consumed < size) {
+    if (static_cast<int64_t>(input_.size()) == block_size_) {
+      if (pending() > 0) {
+        break;
+      }
+      EncodeInput();
+    }
+    int64_t length = std::min<int64_t>(
+        size - consumed, block_size_ - static_cast<int64_t>(input_.size()));
+    input_.insert(input_.end(), bytes + consumed, bytes + consumed + length);
+    consumed += length;
+  }
+
+  // A full block is coded at once, so that its output can be pulled
+  // without waiting for the next push.
+  if (static_cast<int64_t>(input_.size()) == block_size_ && pending() == 0) {
+    EncodeInput();
+  }
+  return consumed;
+}
+
+int64_t HuffmanEncoderStream::Pull(void* buffer, int64_t capacity) {
+  return Drain(output_, &output_position_, buffer, capacity);
+}
+
+void HuffmanEncoderStream::Flush() {
+  if (!input_.empty()) {
+    EncodeInput();
+  }
+}
+
+void HuffmanEncoderStream::EncodeInput() {
+  void* block = nullptr;
+  int64_t block_size = -1;
+  EncodeBlock(input_.data(), static_cast<int64_t>(input_.size()), &block,
+              &block_size);
+
+  Compact(&output_, &output_position_);
+  uint64_t frame_size = static_cast<uint64_t>(block_size);
+  const uint8_t* header = reinterpret_cast<const uint8_t*>(&frame_size);
+  output_.insert(output_.end(), header, header + sizeof(frame_size));
+  const uint8_t* block_bytes = reinterpret_cast<const uint8_t*>(block);
+  output_.insert(output_.end(), block_bytes, block_bytes + block_size);
+
+  delete[] reinterpret_cast<uint8_t*>(block);
+  input_.clear();
+}
+
+HuffmanDecoderStream::HuffmanDecoderStream(int64_t max_block_size)
+    : max_block_size_(std::max<int64_t>(max_block_size, 1)) {}
+
+bool HuffmanDecoderStream::Push(const void* data, int64_t size,
+                                int64_t* consumed) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+
+  *consumed = 0;
+  while (!failed_ && *consumed < size && pending() == 0) {
+    // Collect the size, and then the block.
+    uint64_t wanted = sizeof(frame_size_);
+    if (frame_.size() >= sizeof(frame_size_)) {
+      wanted += frame_size_;
+    }
+    int64_t length = std::min<int64_t>(
+        size - *consumed, static_cast<int64_t>(wanted - frame_.size()));
+    frame_.insert(frame_.end(), bytes + *consumed, bytes + *consumed + length);
+    *consumed += length;
+
+    if (frame_.size() == sizeof(frame_size_)) {
+      // No block may be larger than its data stored verbatim.
+      memcpy(&frame_size_, frame_.data(), sizeof(frame_size_));
+      if (frame_size_ < static_cast<uint64_t>(kBlockHeaderSize) ||
+          frame_size_ > static_cast<uint64_t>(max_block_size_ +
+                                              kBlockHeaderSize)) {
+        failed_ = true;
+      }
+    } else if (frame_.size() == sizeof(frame_size_) + frame_size_) {
+      failed_ = !DecodeFrame();
+    }
+  }
+  return !failed_;
+}
+
+int64_t HuffmanDecoderStream::Pull(void* buffer, int64_t capacity) {
+  return Drain(output_, &output_position_, buffer, capacity);
+}
+
+bool HuffmanDecoderStream::DecodeFrame() {
+  const uint8_t* block = frame_.data() + sizeof(frame_size_);
+
+  // The uncompressed size is checked before any memory is allocated for it.
+  void* decoded = nullptr;
+  int64_t decoded_size = -1;
+  if (!DecodeBlock(block, static_cast<int64_t>(frame_size_), &decoded,
+                   &decoded_size, max_block_size_)) {
+    return false;
+  }
+
+  const uint8_t* decoded_bytes = reinterpret_cast<const uint8_t*>(decoded);
+  output_.assign(decoded_bytes, decoded_bytes + decoded_size);
+  output_position_ = 0;
+  delete[] reinterpret_cast<uint8_t*>(decoded);
+
+  frame_.clear();
+  frame_size_ = 0;
+  return true;
+}
+}  // namespace compression
@@ -0,0 +1,126 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// These classes compress and decompress data incrementally, for callers
+// which cannot hold a whole payload in memory. Input of any length is
+// pushed in, and output is pulled out into buffers of any capacity, in the
+// manner of zlib's |deflate| and |inflate|.
+//
+// A Huffman code needs the histogram of the text before the first symbol
+// can be coded, so the encoder collects input into blocks of at most
+// |block_size| bytes and codes each as described in "compression/block.h".
+// Each block is written as a frame: a 64-bit block size followed by the
+// block. This is the format of an archive written by |huffman -c| without
+// |--checksum| or |--sync|, so either can read the other's output.
+//
+// Each object holds at most one block of input and one or two frames of
+// output at a time. Once that is full, |Push| consumes nothing more until
+// output has been pulled, so memory use does not depend on the length of
+// the stream.
+//
+// A typical encoding loop is:
+//
+//   HuffmanEncoderStream encoder;
+//   while (there is input) {
+//     int64_t consumed = encoder.Push(input, input_size);
+//     ... advance |input| by |consumed| ...
+//     while ((size = encoder.Pull(buffer, sizeof(buffer))) > 0) {
+//       ... write |size| bytes of |buffer| ...
+//     }
+//   }
+//   encoder.Flush();
+//   ... pull until empty, as above ...
+
+#ifndef HUFFMAN_COMPRESSION_STREAM_H_
+#define HUFFMAN_COMPRESSION_STREAM_H_
+
+#include <cstdint>
+
+#include <vector>
+
+namespace compression {
+// The number of uncompressed bytes in each block, unless otherwise given.
+static constexpr int64_t kDefaultStreamBlockSize = 1 << 20;
+
+class HuffmanEncoderStream {
+ public:
+  explicit HuffmanEncoderStream(
+      int64_t block_size = kDefaultStreamBlockSize);
+
+  // Consumes as many of the |size| bytes at |data| as can be held, and
+  // returns the number consumed. This is less than |size| only if output
+  // must be pulled first.
+  int64_t Push(const void* data, int64_t size);
+
+  // Copies at most |capacity| bytes of output to |buffer|, and returns the
+  // number copied. Returns |0| when no output is ready.
+  int64_t Pull(void* buffer, int64_t capacity);
+
+  // Codes any input which does not yet fill a block, so that all of the
+  // input pushed so far can be pulled. Flushing often makes smaller blocks,
+  // which compress less well.
+  void Flush();
+
+  // Returns the number of bytes of output which are ready to be pulled.
+  int64_t pending() const {
+    return static_cast<int64_t>(output_.size()) - output_position_;
+  }
+
+ private:
+  // Codes |input_| as a frame appended to |output_|.
+  void EncodeInput();
+
+  int64_t block_size_;
+  std::vector<uint8_t> input_ = {};
+  std::vector<uint8_t> output_ = {};
+  int64_t output_position_ = 0;
+};  // class HuffmanEncoderStream
+
+class HuffmanDecoderStream {
+ public:
+  // Frames holding more than |max_block_size| uncompressed bytes are
+  // rejected as corrupt, so that a damaged size cannot exhaust memory. This
+  // should be at least the |block_size| of the encoder.
+  explicit HuffmanDecoderStream(
+      int64_t max_block_size = kDefaultStreamBlockSize);
+
+  // Consumes as many of the |size| bytes at |data| as can be held, setting
+  // |*consumed| to the number consumed. This is less than |size| only if
+  // output must be pulled first.
+  //
+  // Returns false if the stream is corrupt, after which every call fails.
+  bool Push(const void* data, int64_t size, int64_t* consumed);
+
+  // Copies at most |capacity| bytes of output to |buffer|, and returns the
+  // number copied. Returns |0| when no output is ready.
+  int64_t Pull(void* buffer, int64_t capacity);
+
+  // Returns true if the input pushed so far ends between frames. If it
+  // does not once all input has been pushed, the stream was truncated.
+  bool finished() const {
+    return !failed_ && frame_.empty();
+  }
+
+  // Returns the number of bytes of output which are ready to be pulled.
+  int64_t pending() const {
+    return static_cast<int64_t>(output_.size()) - output_position_;
+  }
+
+ private:
+  // Decodes the complete frame held in |frame_| into |output_|.
+  bool DecodeFrame();
+
+  int64_t max_block_size_;
+  bool failed_ = false;
+
+  // The frame being received. Its size is known once it holds the first
+  // eight bytes.
+  std::vector<uint8_t> frame_ = {};
+  uint64_t frame_size_ = 0;
+
+  std::vector<uint8_t> output_ = {};
+  int64_t output_position_ = 0;
+};  // class HuffmanDecoderStream
+}  // namespace compression
+
+#endif  // HUFFMAN_COMPRESSION_STREAM_H_
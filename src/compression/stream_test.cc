@@ -0,0 +1,160 @@
+// Copyright: Peter Sanders. All rights reserved.
+// Date: 2026-10-18
+//
+// Unit test for streaming compression
+// Assumes block encoding is sane
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "compression/block.h"
+#include "compression/stream.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+using compression::HuffmanDecoderStream;
+using compression::HuffmanEncoderStream;
+
+namespace {
+// Pushes |data| through |encoder| in pieces of random length no longer than
+// |max_piece|, pulling into a buffer of |capacity| bytes after each push.
+vector<uint8_t> Encode(const vector<uint8_t>& data, int64_t block_size,
+                       int max_piece, int capacity) {
+  HuffmanEncoderStream encoder(block_size);
+  vector<uint8_t> buffer(static_cast<size_t>(capacity));
+  vector<uint8_t> out;
+
+  int64_t position = 0;
+  while (position < static_cast<int64_t>(data.size())) {
+    int64_t piece = std::min<int64_t>(
+        1 + rand() % max_piece, static_cast<int64_t>(data.size()) - position);
+    position += encoder.Push(data.data() + position, piece);
+    int64_t size;
+    while ((size = encoder.Pull(buffer.data(), capacity)) > 0) {
+      out.insert(out.end(), buffer.begin(), buffer.begin() + size);
+    }
+  }
+  encoder.Flush();
+  int64_t size;
+  while ((size = encoder.Pull(buffer.data(), capacity)) > 0) {
+    out.insert(out.end(), buffer.begin(), buffer.begin() + size);
+  }
+  return out;
+}
+
+// As above, for |decoder|. Returns false if the decoder rejects the
+// stream or it is truncated.
+bool Decode(const vector<uint8_t>& stream, int64_t max_block_size,
+            int max_piece, int capacity, vector<uint8_t>* out) {
+  HuffmanDecoderStream decoder(max_block_size);
+  vector<uint8_t> buffer(static_cast<size_t>(capacity));
+
+  int64_t position = 0;
+  while (position < static_cast<int64_t>(stream.size())) {
+    int64_t piece = std::min<int64_t>(
+        1 + rand() % max_piece, static_cast<int64_t>(stream.size()) - position);
+    int64_t consumed;
+    if (!decoder.Push(stream.data() + position, piece, &consumed)) {
+      return false;
+    }
+    position += consumed;
+    int64_t size;
+    while ((size = decoder.Pull(buffer.data(), capacity)) > 0) {
+      out->insert(out->end(), buffer.begin(), buffer.begin() + size);
+    }
+  }
+  return decoder.finished();
+}
+
+bool RoundTrip(const string& name, const vector<uint8_t>& data,
+               int64_t block_size, int max_piece, int capacity) {
+  vector<uint8_t> stream = Encode(data, block_size, max_piece, capacity);
+  vector<uint8_t> decoded;
+  bool sane = Decode(stream, block_size, max_piece, capacity, &decoded);
+  bool fidelity = sane && decoded == data;
+
+  cout << name << ": " << data.size() << " -> " << stream.size() << " bytes"
+       << "\n  Fidelity: " << fidelity << endl;
+  return fidelity;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool ok = true;
+  srand(1);
+
+  vector<uint8_t> text;
+  string words[] = {"the ", "quick ", "brown ", "fox ", "jumps ", "over ",
+                    "lazy ", "dog ", "\n"};
+  while (text.size() < 300000) {
+    const string& word = words[rand() % 9];
+    text.insert(text.end(), word.begin(), word.end());
+  }
+  vector<uint8_t> noise(100000);
+  for (auto& n : noise) {
+    n = rand();
+  }
+
+  ok &= RoundTrip("Empty", vector<uint8_t>(), 4096, 100, 64);
+  ok &= RoundTrip("One byte", vector<uint8_t>(1, 'x'), 4096, 100, 64);
+  ok &= RoundTrip("Text", text, 65536, 10000, 4096);
+  ok &= RoundTrip("Text, small pieces", text, 65536, 7, 3);
+  ok &= RoundTrip("Text, small blocks", text, 100, 1000, 4096);
+  ok &= RoundTrip("Text, one buffer", text, 1 << 20, 1 << 20, 1 << 20);
+  ok &= RoundTrip("Noise", noise, 65536, 10000, 4096);
+
+  // The stream is a sequence of frames, each decodable by itself.
+  vector<uint8_t> stream = Encode(text, 65536, 10000, 4096);
+  vector<uint8_t> frames;
+  const uint8_t* frame = stream.data();
+  bool framed = true;
+  while (framed && frame < stream.data() + stream.size()) {
+    uint64_t frame_size;
+    memcpy(&frame_size, frame, sizeof(frame_size));
+    void* block = nullptr;
+    int64_t block_size = -1;
+    framed = compression::DecodeBlock(frame + sizeof(frame_size),
+                                      static_cast<int64_t>(frame_size),
+                                      &block, &block_size);
+    if (framed) {
+      const uint8_t* bytes = reinterpret_cast<const uint8_t*>(block);
+      frames.insert(frames.end(), bytes, bytes + block_size);
+    }
+    delete[] reinterpret_cast<uint8_t*>(block);
+    frame += sizeof(frame_size) + frame_size;
+  }
+  framed &= (frames == text);
+  cout << "Frames decode as blocks: " << framed << endl;
+  ok &= framed;
+
+  // Damage must be reported rather than decoded.
+  vector<uint8_t> decoded;
+  vector<uint8_t> truncated(stream.begin(), stream.end() - 1);
+  bool rejected = !Decode(truncated, 65536, 1000, 4096, &decoded);
+  cout << "Truncated stream rejected: " << rejected << endl;
+  ok &= rejected;
+
+  vector<uint8_t> oversized = stream;
+  oversized[5] = 0x7F;
+  decoded.clear();
+  rejected = !Decode(oversized, 65536, 1000, 4096, &decoded);
+  cout << "Oversized frame rejected: " << rejected << endl;
+  ok &= rejected;
+
+  decoded.clear();
+  rejected = !Decode(stream, 1024, 1000, 4096, &decoded);
+  cout << "Block larger than the limit rejected: " << rejected << endl;
+  ok &= rejected;
+
+  cout << "All passed: " << ok << endl;
+  return ok ? 0 : 1;
+}
@@ -3,7 +3,9 @@
 
 #include <cstdlib>
 #include <cstdint>
+#include <cstring>
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -12,8 +14,11 @@
 #include <glog/logging.h>
 #include <gflags/gflags.h>
 
-#include "base/bitstring.h"
-#include "huffman/huffman.h"
+#include "base/crc32c.h"
+#include "base/pipeline.h"
+#include "base/stats.h"
+#include "compression/archive.h"
+#include "compression/block.h"
 
 using std::cout;
 using std::cerr;
@@ -26,10 +31,40 @@ using std::ios;
 using std::string;
 using std::vector;
 
+using compression::kChecksummedFrame;
+using compression::kChecksumsSize;
+using compression::kSyncMarker;
+
 DEFINE_string(f, "archive.huf", "A .huf archive");
 DEFINE_bool(c, false, "Create an archive");
 DEFINE_bool(x, false, "Extract an archive");
+DEFINE_int64(block_size, 1 << 20, "Uncompressed bytes per archive block");
+DEFINE_int32(pipeline_depth, 4, "Blocks in flight between stages");
+DEFINE_bool(checksum, false, "Checksum each block when creating an archive");
+DEFINE_bool(sync, false, "Begin each frame with a sync marker");
+DEFINE_bool(skip_corrupt, false,
+            "When extracting, skip blocks which fail to verify or decode");
+DEFINE_bool(recover, false,
+            "When extracting, skip corrupt blocks and damaged framing");
+DEFINE_bool(stats, false, "Print codec statistics as JSON");
+
+// A block on its way through the pipeline. |input| is reused from one block
+// to the next; |output| is allocated by the coder and freed once written.
+struct Chunk : compression::Frame {
+  ~Chunk() {
+    delete[] reinterpret_cast<uint8_t*>(output);
+  }
+
+  void* output = nullptr;
+  int64_t output_size = 0;
+};
 
+// Archives are described in "compression/archive.h".
+//
+// Both |create| and |extract| read, code and write concurrently, as
+// described in "base/pipeline.h". They hold at most |--pipeline_depth|
+// blocks in memory at a time, so files of any size can be processed in a
+// single pass.
 void create(char* data_file_name) {
   // Open files
   ifstream data_file(data_file_name, std::ios::binary);
@@ -44,45 +79,86 @@ void create(char* data_file_name) {
     exit(1);
   }
 
-  // Find size of uncompressed file and create a buffer to hold it
-  int in_size = data_file.tellg();
-  data_file.seekg(0, ios::end);
-  in_size = data_file.tellg() - in_size;
-  data_file.seekg(0, ios::beg);
+  if (FLAGS_block_size <= 0 || FLAGS_block_size > compression::kMaxBlockSize) {
+    cerr << "Block size must be positive and at most "
+         << compression::kMaxBlockSize << "." << endl;
+    exit(1);
+  }
 
-  // Read the uncompressed file into the buffer and close the file stream
-  void* in_buffer = new char[in_size];
-  data_file.read(in_buffer, in_size);
+  // Encode each block independently so that each may use whichever
+  // representation suits its own contents. A read error ends the input like
+  // the end of the file does, so it is told apart afterwards.
+  bool read_error = false;
+  base::Pipeline<Chunk> pipeline(std::max(FLAGS_pipeline_depth, 1));
+  bool written = pipeline.Run(
+      [&data_file, &read_error](Chunk* chunk) {
+        STATS_TIMER(kReadStage);
+        chunk->input.resize(static_cast<size_t>(FLAGS_block_size));
+        data_file.read(chunk->input.data(), FLAGS_block_size);
+        chunk->input_size = data_file.gcount();
+        read_error = data_file.bad();
+        return chunk->input_size > 0 && !read_error;
+      },
+      [](Chunk* chunk) {
+        compression::EncodeBlock(chunk->input.data(), chunk->input_size,
+                                 &chunk->output, &chunk->output_size);
+        // The checksums are separate passes rather than folded into the
+        // coders, which would thread them through every block mode. With
+        // the hardware instruction both cost about 6% of the time taken to
+        // encode a 1 MiB block of text.
+        if (FLAGS_checksum) {
+          STATS_TIMER(kChecksumStage);
+          chunk->block_crc = base::Crc32c(chunk->output, chunk->output_size);
+          chunk->data_crc = base::Crc32c(chunk->input.data(),
+                                         chunk->input_size);
+        }
+        return true;
+      },
+      [&archive_file](Chunk* chunk) {
+        STATS_TIMER(kWriteStage);
+        uint64_t frame_size = static_cast<uint64_t>(chunk->output_size);
+        if (FLAGS_checksum) {
+          frame_size |= kChecksummedFrame;
+        }
+        if (FLAGS_sync) {
+          archive_file.write(kSyncMarker, sizeof(kSyncMarker));
+        }
+        archive_file.write(reinterpret_cast<char*>(&frame_size),
+                           sizeof(frame_size));
+        archive_file.write(reinterpret_cast<char*>(chunk->output),
+                           chunk->output_size);
+        if (FLAGS_checksum) {
+          archive_file.write(reinterpret_cast<char*>(&chunk->block_crc),
+                             sizeof(chunk->block_crc));
+          archive_file.write(reinterpret_cast<char*>(&chunk->data_crc),
+                             sizeof(chunk->data_crc));
+        }
+        delete[] reinterpret_cast<uint8_t*>(chunk->output);
+        chunk->output = nullptr;
+        if (!archive_file) {
+          return false;
+        }
+        STATS_ADD(kBytesIn, static_cast<uint64_t>(chunk->input_size));
+        STATS_ADD(kBytesOut, sizeof(frame_size) +
+                  static_cast<uint64_t>(chunk->output_size) +
+                  (FLAGS_checksum ? kChecksumsSize : 0) +
+                  (FLAGS_sync ? sizeof(kSyncMarker) : 0));
+        return true;
+      });
   data_file.close();
 
-  // Create a Huffman Coding object and initialize the histogram
-  // from the file buffer.
-  huffman::Huffman huf;
-  huf.BuildTree(in_buffer, in_size);
-
-  // Create and write the header of the oputput file
-  void* out_buffer = nullptr;
-  int out_size = -1;
-  huf.Serialize(&out_buffer, &out_size);
-  archive_file.write(out_buffer, out_size);
-  delete[] out_buffer;
-
-  // Encode the uncompressed file into a packed bitstring and delete the buffer
-  huf.BuildMap();
-  base::BitString encoded;
-  huf.Encode(in_buffer, in_size, &encoded);
-  delete[] in_buffer;
-
-  // Serialize the bitstring and write it to the archive.
-  out_buffer = nullptr;
-  out_size = -1;
-  encoded.Serialize(reinterpret_cast<uint8_t**>(&out_buffer), &out_size);
-  archive_file.write(out_buffer, out_size);
-  delete[] out_buffer;
-
   // Flush and close the archive file
   archive_file.flush();
   archive_file.close();
+
+  if (read_error) {
+    cerr << "Failed to read " << data_file_name << "." << endl;
+    exit(1);
+  }
+  if (!written || !archive_file) {
+    cerr << "Failed to write " << FLAGS_f << "." << endl;
+    exit(1);
+  }
 }
 
 void extract(char* data_file_name) {
@@ -99,45 +175,103 @@ void extract(char* data_file_name) {
     exit(1);
   }
 
-  // Find size of archive file and create a buffer to hold it
-  int in_size = archive.tellg();
-  archive.seekg(0, ios::end);
-  in_size = archive.tellg() - in_size;
-  archive.seekg(0, ios::beg);
+  // The reader cannot stop the program itself, as the blocks before a
+  // truncated one must still be written. Its error is reported afterwards.
+  compression::FrameReader reader(&archive, FLAGS_recover);
+  const char* decode_error = nullptr;
+  int64_t failed_offset = 0;
+  int64_t output_position = 0;
+  int64_t skipped = 0;
+  bool write_error = false;
+  base::Pipeline<Chunk> pipeline(std::max(FLAGS_pipeline_depth, 1));
+  bool decoded = pipeline.Run(
+      [&reader](Chunk* chunk) {
+        STATS_TIMER(kReadStage);
+        return reader.Read(chunk);
+      },
+      [&](Chunk* chunk) {
+        if (chunk->error != nullptr) {
+          return true;  // The reader skipped a damaged region.
+        }
+        chunk->error = compression::DecodeFrame(*chunk, &chunk->output,
+                                                &chunk->output_size);
+        if (chunk->error != nullptr &&
+            !FLAGS_skip_corrupt && !FLAGS_recover) {
+          decode_error = chunk->error;
+          failed_offset = chunk->offset;
+          return false;
+        }
+        return true;
+      },
+      [&](Chunk* chunk) {
+        if (chunk->error != nullptr) {
+          cerr << chunk->error << " at byte " << chunk->offset;
+          if (chunk->damaged_end != 0) {
+            cerr << "; skipped bytes " << chunk->offset << " to "
+                 << chunk->damaged_end;
+          } else {
+            cerr << "; skipped";
+          }
+          cerr << ", missing from output byte " << output_position << endl;
+          ++skipped;
+          return true;
+        }
 
-  // Read the archive into the buffer and close the file stream
-  char* in_buffer = new char[in_size];
-  archive.read(in_buffer, in_size);
-  archive.close();
+        STATS_TIMER(kWriteStage);
+        decompressed.write(reinterpret_cast<char*>(chunk->output),
+                           chunk->output_size);
+        delete[] reinterpret_cast<uint8_t*>(chunk->output);
+        chunk->output = nullptr;
+        if (!decompressed) {
+          write_error = true;
+          return false;
+        }
+        output_position += chunk->output_size;
+        STATS_ADD(kBytesIn, sizeof(uint64_t) +
+                  static_cast<uint64_t>(chunk->input_size) +
+                  (chunk->checksummed ? kChecksumsSize : 0));
+        STATS_ADD(kBytesOut, static_cast<uint64_t>(chunk->output_size));
+        return true;
+      });
 
-  // Unserialize histogram
-  huffman::Huffman huf;
-  huf.Unserialize(reinterpret_cast<uint8_t*>(in_buffer), in_size);
-
-  // Unserialize data segment
-  int bitstring_size = in_size - huffman::Huffman::get_header_size(
-      reinterpret_cast<uint8_t*>(in_buffer));
-
-  cout << "Archive has\nHeader: " << (in_size - bitstring_size)
-       << "\nData: " << bitstring_size
-       << "\nTotal: " << in_size << endl;
-  base::BitString bits;
-  if (!bits.Unserialize(huffman::Huffman::get_data_segment(
-	   reinterpret_cast<uint8_t*>(in_buffer)), bitstring_size)) {
-    cout << "Failed to unserialize bitstring" << endl;
-    delete[] in_buffer;
+  if (write_error) {
+    cerr << "Failed to write " << data_file_name << "." << endl;
     exit(1);
   }
-  delete[] in_buffer;
+  // A block which failed to decode precedes anything the reader found.
+  if (!decoded) {
+    cerr << decode_error << " at byte " << failed_offset << endl;
+    exit(1);
+  }
+  if (reader.error() != nullptr) {
+    cerr << reader.error() << " at byte " << reader.position() << endl;
+    exit(1);
+  }
+  if (skipped > 0) {
+    cerr << skipped << " corrupt blocks or damaged regions were skipped";
+    if (reader.damaged_size() > 0) {
+      cerr << ", losing " << reader.damaged_size() << " bytes of the archive";
+    }
+    cerr << "." << endl;
+    exit(1);
+  }
+  archive.close();
 
-  // Decode BitString
-  vector<uint8_t> out_buffer = huf.Decode(bits);
-  const char* out_ptr = reinterpret_cast<char*>(out_buffer.data());
-  decompressed.write(out_ptr, out_buffer.size());
+  // The statistics replace the summary, so that the output is all JSON.
+  if (!FLAGS_stats) {
+    cout << "Archive has\nHeader: " << reader.header_size()
+         << "\nData: " << reader.data_size()
+         << "\nTotal: " << (reader.header_size() + reader.data_size())
+         << endl;
+  }
 
   // Flush and close file
   decompressed.flush();
   decompressed.close();
+  if (!decompressed) {
+    cerr << "Failed to write " << data_file_name << "." << endl;
+    exit(1);
+  }
 }
 
 int main(int argc, char** argv) {
@@ -157,6 +291,14 @@ int main(int argc, char** argv) {
     create(argv[1]);
   }
 
+  if (FLAGS_stats) {
+#ifndef HUFFMAN_STATS
+    cerr << "Statistics were not compiled in; rebuild with `make STATS=1`."
+         << endl;
+#endif
+    cout << base::stats::ToJson() << endl;
+  }
+
   gflags::ShutDownCommandLineFlags();
   return 0;
 }